@@ -0,0 +1,342 @@
+/*
+ * AsyncLog.c
+ *
+ * Every logging thread owns a single-producer ring, the rings are pushed onto a lock-free list on the first
+ * message of their thread. The writer thread is the only consumer of all rings.
+ */
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "AsyncLog.h"
+#include "Placement.h"
+#ifdef MCC_SIMULATION
+#include "SimulationClock.h"
+#endif
+
+typedef struct AsyncLogRing {
+	uint32_T head MCC_CACHE_ALIGNED; /**< the next record to write, only advanced by the writer thread */
+	uint32_T tail MCC_CACHE_ALIGNED; /**< the next free record, only advanced by the logging thread */
+	uint64_T dropped; /**< messages dropped, because the ring was full */
+	uint64_T reported; /**< dropped messages already reported in the log, only used by the writer thread */
+	uint16_T thread;
+	struct AsyncLogRing* next;
+	AsyncLogRecord records[MCC_LOG_RING_SIZE];
+} AsyncLogRing;
+
+static __thread AsyncLogRing* thread_ring = NULL;
+static AsyncLogRing* rings = NULL;
+static uint32_T thread_count = 0;
+
+static const AsyncLogFormat* formats[MCC_LOG_MAX_FORMATS];
+static uint32_T format_count = 0;
+//formats already written to the file, only used by the writer thread
+static bool_t format_written[MCC_LOG_MAX_FORMATS];
+static AsyncLogFormat dropped_format = { .format = "AsyncLog: %llu messages of thread %u dropped\n" };
+
+static bool_t logging = false;
+static FILE* log_file = NULL;
+static pthread_t writer_thread;
+static bool_t writer_running = false;
+
+static uint64_T now(void) {
+#ifdef MCC_SIMULATION
+	return SimulationClock_now();
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_T) ts.tv_sec * 1000000000u + (uint64_T) ts.tv_nsec;
+#endif
+}
+
+size_t AsyncLog_nextConversion(const char* format, int* kind) {
+	size_t i = 0;
+	size_t j;
+	int length;
+	while (format[i] != '\0') {
+		if (format[i] != '%') {
+			i++;
+			continue;
+		}
+		if (format[i + 1] == '%') {
+			i += 2;
+			continue;
+		}
+		j = i + 1;
+		while (format[j] != '\0' && strchr("-+ #0123456789.", format[j]) != NULL) {
+			j++;
+		}
+		//0: int, 1: long or size_t, 2: long long
+		length = 0;
+		while (format[j] != '\0' && strchr("hlzjt", format[j]) != NULL) {
+			length = format[j] == 'h' ? length : (format[j] == 'j' || length == 1 ? 2 : 1);
+			j++;
+		}
+		if (format[j] == '\0') {
+			i = j;
+			break;
+		}
+		if (strchr("diuxXoc", format[j]) != NULL) {
+			*kind = length == 0 ? LOG_ARG_INT : (length == 1 ? LOG_ARG_LONG : LOG_ARG_LLONG);
+			return j + 1;
+		}
+		if (strchr("fFeEgGaA", format[j]) != NULL) {
+			*kind = LOG_ARG_DOUBLE;
+			return j + 1;
+		}
+		if (format[j] == 's' || format[j] == 'p') {
+			*kind = format[j] == 's' ? LOG_ARG_STRING : LOG_ARG_POINTER;
+			return j + 1;
+		}
+		//unsupported conversion, printed as text
+		i = j + 1;
+	}
+	*kind = -1;
+	return i;
+}
+
+/*
+ * Parses and registers a format on its first use, false if MCC_LOG_MAX_FORMATS is exceeded
+ */
+static bool_t registerFormat(AsyncLogFormat* format) {
+	uint32_T state = 0;
+	uint32_T id;
+	const char* f;
+	int kind;
+	if (__atomic_load_n(&format->state, __ATOMIC_ACQUIRE) == 2) {
+		return true;
+	}
+	if (!__atomic_compare_exchange_n(&format->state, &state, 1, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+		//another thread parses the format right now
+		while ((state = __atomic_load_n(&format->state, __ATOMIC_ACQUIRE)) == 1) {
+		}
+		return state == 2;
+	}
+	id = __atomic_fetch_add(&format_count, 1, __ATOMIC_RELAXED);
+	if (id >= MCC_LOG_MAX_FORMATS) {
+		__atomic_store_n(&format->state, 3, __ATOMIC_RELEASE);
+		return false;
+	}
+	format->argc = 0;
+	for (f = format->format; *f != '\0' && format->argc < MCC_LOG_MAX_ARGS;) {
+		f += AsyncLog_nextConversion(f, &kind);
+		if (kind >= 0) {
+			format->kinds[format->argc++] = (uint8_T) kind;
+		}
+	}
+	format->id = (uint16_T) id;
+	formats[id] = format;
+	__atomic_store_n(&format->state, 2, __ATOMIC_RELEASE);
+	return true;
+}
+
+static AsyncLogRing* threadRing(void) {
+	AsyncLogRing* ring = thread_ring;
+	if (ring == NULL) {
+		ring = Placement_allocCacheAligned(sizeof(AsyncLogRing));
+		if (ring == NULL) {
+			return NULL;
+		}
+		ring->thread = (uint16_T) __atomic_fetch_add(&thread_count, 1, __ATOMIC_RELAXED);
+		ring->next = __atomic_load_n(&rings, __ATOMIC_RELAXED);
+		while (!__atomic_compare_exchange_n(&rings, &ring->next, ring, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+		}
+		thread_ring = ring;
+	}
+	return ring;
+}
+
+/*
+ * Copies the arguments of a record, as far as they fit into its slots
+ */
+static uint16_T copyArguments(const AsyncLogFormat* format, uint64_T* slots, va_list args) {
+	uint16_T used = 0;
+	uint8_T i;
+	const char* string;
+	double value;
+	for (i = 0; i < format->argc; i++) {
+		if (format->kinds[i] == LOG_ARG_STRING) {
+			if (used + MCC_LOG_STRING_SIZE / 8 > MCC_LOG_MAX_ARGS) {
+				break;
+			}
+			string = va_arg(args, const char*);
+			strncpy((char*) &slots[used], string != NULL ? string : "(null)", MCC_LOG_STRING_SIZE - 1);
+			((char*) &slots[used])[MCC_LOG_STRING_SIZE - 1] = '\0';
+			used += MCC_LOG_STRING_SIZE / 8;
+			continue;
+		}
+		if (used == MCC_LOG_MAX_ARGS) {
+			break;
+		}
+		switch (format->kinds[i]) {
+		case LOG_ARG_INT:
+			slots[used] = (uint64_T) (int64_T) va_arg(args, int);
+			break;
+		case LOG_ARG_LONG:
+			slots[used] = (uint64_T) (int64_T) va_arg(args, long);
+			break;
+		case LOG_ARG_LLONG:
+			slots[used] = (uint64_T) va_arg(args, long long);
+			break;
+		case LOG_ARG_POINTER:
+			slots[used] = (uint64_T) (size_t) va_arg(args, void*);
+			break;
+		default:
+			value = va_arg(args, double);
+			memcpy(&slots[used], &value, sizeof(value));
+			break;
+		}
+		used++;
+	}
+	return used;
+}
+
+void AsyncLog_write(AsyncLogFormat* format, ...) {
+	AsyncLogRing* ring;
+	AsyncLogRecord* record;
+	uint32_T tail;
+	va_list args;
+
+	va_start(args, format);
+	if (!__atomic_load_n(&logging, __ATOMIC_ACQUIRE)) {
+		vprintf(format->format, args);
+		va_end(args);
+		return;
+	}
+	ring = threadRing();
+	if (ring == NULL || !registerFormat(format)) {
+		va_end(args);
+		return;
+	}
+	tail = ring->tail;
+	if (tail - __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) == MCC_LOG_RING_SIZE) {
+		__atomic_store_n(&ring->dropped, ring->dropped + 1, __ATOMIC_RELAXED);
+		va_end(args);
+		return;
+	}
+	record = &ring->records[tail & (MCC_LOG_RING_SIZE - 1)];
+	record->timestamp = now();
+	record->format = format->id;
+	record->thread = ring->thread;
+	record->slots = copyArguments(format, record->args, args);
+	__atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+	va_end(args);
+}
+
+static void writeRecord(const AsyncLogRecord* record) {
+	const AsyncLogFormat* format = formats[record->format];
+	uint32_T tag;
+	uint16_T length;
+	if (!format_written[record->format]) {
+		tag = LOG_ENTRY_FORMAT;
+		length = (uint16_T) strlen(format->format);
+		fwrite(&tag, sizeof(tag), 1, log_file);
+		fwrite(&record->format, sizeof(record->format), 1, log_file);
+		fwrite(&length, sizeof(length), 1, log_file);
+		fwrite(format->format, 1, length, log_file);
+		format_written[record->format] = true;
+	}
+	tag = LOG_ENTRY_RECORD;
+	fwrite(&tag, sizeof(tag), 1, log_file);
+	fwrite(record, sizeof(AsyncLogRecord), 1, log_file);
+}
+
+static void reportDropped(AsyncLogRing* ring) {
+	AsyncLogRecord record;
+	uint64_T dropped = __atomic_load_n(&ring->dropped, __ATOMIC_RELAXED);
+	if (dropped == ring->reported || !registerFormat(&dropped_format)) {
+		return;
+	}
+	memset(&record, 0, sizeof(record));
+	record.timestamp = now();
+	record.format = dropped_format.id;
+	record.thread = ring->thread;
+	record.slots = 2;
+	record.args[0] = dropped - ring->reported;
+	record.args[1] = ring->thread;
+	writeRecord(&record);
+	ring->reported = dropped;
+}
+
+static uint32_T drain(void) {
+	AsyncLogRing* ring;
+	uint32_T head;
+	uint32_T tail;
+	uint32_T written = 0;
+	for (ring = __atomic_load_n(&rings, __ATOMIC_ACQUIRE); ring != NULL; ring = ring->next) {
+		head = ring->head;
+		tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+		for (; head != tail; head++) {
+			writeRecord(&ring->records[head & (MCC_LOG_RING_SIZE - 1)]);
+			written++;
+		}
+		__atomic_store_n(&ring->head, head, __ATOMIC_RELEASE);
+		reportDropped(ring);
+	}
+	if (written > 0) {
+		fflush(log_file);
+	}
+	return written;
+}
+
+static void* writer(void* arg) {
+	struct timespec interval = { 0, MCC_LOG_FLUSH_INTERVAL_NS };
+
+	while (__atomic_load_n(&writer_running, __ATOMIC_ACQUIRE)) {
+		if (drain() == 0) {
+			nanosleep(&interval, NULL);
+		}
+	}
+	drain();
+	return NULL;
+}
+
+int AsyncLog_open(const char* path) {
+	AsyncLogFileHeader header;
+
+	if (log_file != NULL) {
+		return -1;
+	}
+	log_file = fopen(path, "wb");
+	if (log_file == NULL) {
+		printf("AsyncLog: cannot open %s\n", path);
+		return -1;
+	}
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, MCC_LOG_MAGIC, sizeof(header.magic));
+	header.version = MCC_LOG_VERSION;
+	header.recordSize = sizeof(AsyncLogRecord);
+	header.stringSize = MCC_LOG_STRING_SIZE;
+	fwrite(&header, sizeof(header), 1, log_file);
+
+	writer_running = true;
+	if (pthread_create(&writer_thread, NULL, &writer, NULL) != 0) {
+		printf("AsyncLog: cannot start the writer thread\n");
+		writer_running = false;
+		fclose(log_file);
+		log_file = NULL;
+		return -1;
+	}
+	__atomic_store_n(&logging, true, __ATOMIC_RELEASE);
+	return 0;
+}
+
+void AsyncLog_close(void) {
+	if (log_file == NULL) {
+		return;
+	}
+	__atomic_store_n(&logging, false, __ATOMIC_RELEASE);
+	__atomic_store_n(&writer_running, false, __ATOMIC_RELEASE);
+	pthread_join(writer_thread, NULL);
+	fclose(log_file);
+	log_file = NULL;
+}
+
+uint64_T AsyncLog_getDropped(void) {
+	AsyncLogRing* ring;
+	uint64_T dropped = 0;
+	for (ring = __atomic_load_n(&rings, __ATOMIC_ACQUIRE); ring != NULL; ring = ring->next) {
+		dropped += __atomic_load_n(&ring->dropped, __ATOMIC_RELAXED);
+	}
+	return dropped;
+}
@@ -0,0 +1,140 @@
+/**
+ * @file
+ * @brief Asynchronous binary log of an ECU
+ * @details If the container is compiled with MCC_ASYNC_LOG, MCC_LOG does not format its message: it copies the
+ * identifier of the format and the raw arguments into a lock-free ring of the calling thread, which a background
+ * thread writes into a binary file. The file is turned into text offline by logdecode (container_lib/AsyncLogDecode.c).
+ * So logging neither blocks on stdout nor formats on the control thread or in a DDS listener thread.
+ * Without MCC_ASYNC_LOG, and before AsyncLog_open, MCC_LOG is printf.
+ *
+ * The format is a printf format with the conversions d i u x X o c p s f F e E g G a A and the length modifiers
+ * hh h l ll z j t; neither * nor L are supported. A %s argument is copied, at most MCC_LOG_STRING_SIZE - 1 characters.
+ * The format must be a string literal, it is identified by its address.
+ *
+ * The file consists of an AsyncLogFileHeader followed by entries, each starting with an AsyncLogEntryTag:
+ * a format entry (uint16_T identifier, uint16_T length, the characters without terminating zero) precedes
+ * the first record of the format, a record entry is followed by an AsyncLogRecord.
+ */
+#ifndef ASYNCLOG_H_
+#define ASYNCLOG_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdio.h>
+#include "standardTypes.h"
+
+#ifndef MCC_LOG_RING_SIZE
+#define MCC_LOG_RING_SIZE 256 /**< number of AsyncLogRecord%s in the ring of a thread, must be a power of two */
+#endif
+
+#ifndef MCC_LOG_MAX_FORMATS
+#define MCC_LOG_MAX_FORMATS 512 /**< number of distinct formats of an ECU */
+#endif
+
+#ifndef MCC_LOG_FLUSH_INTERVAL_NS
+#define MCC_LOG_FLUSH_INTERVAL_NS 10000000 /**< sleep of the writer thread, if all rings are empty */
+#endif
+
+#define MCC_LOG_MAX_ARGS 16 /**< the 8 byte argument slots of a record */
+#define MCC_LOG_STRING_SIZE 64 /**< bytes of a copied %s argument, it takes MCC_LOG_STRING_SIZE / 8 slots */
+
+#define MCC_LOG_MAGIC "MCCLOG\0\0"
+#define MCC_LOG_VERSION 1
+
+/**
+ * @brief The kinds of arguments, derived from the conversions of a format
+ */
+typedef enum {
+	LOG_ARG_INT, /**< an int after the default argument promotions */
+	LOG_ARG_LONG, /**< a long, size_t or ptrdiff_t */
+	LOG_ARG_LLONG, /**< a long long or intmax_t */
+	LOG_ARG_POINTER, /**< a pointer, logged as its address */
+	LOG_ARG_DOUBLE, /**< a float or double */
+	LOG_ARG_STRING /**< a copied string */
+} AsyncLogArgKind;
+
+/**
+ * @brief A format of a call site of MCC_LOG, parsed on its first use
+ */
+typedef struct AsyncLogFormat {
+	const char* format; /**< the printf format */
+	uint32_T state; /**< 0 new, 1 parsing, 2 registered, 3 rejected because of MCC_LOG_MAX_FORMATS */
+	uint16_T id; /**< the identifier in the log file */
+	uint8_T argc; /**< the number of arguments */
+	uint8_T kinds[MCC_LOG_MAX_ARGS]; /**< the AsyncLogArgKind of every argument */
+} AsyncLogFormat;
+
+/**
+ * @brief The tags of the entries of a log file
+ */
+typedef enum {
+	LOG_ENTRY_FORMAT = 1, LOG_ENTRY_RECORD
+} AsyncLogEntryTag;
+
+/**
+ * @brief The header at the start of a log file
+ */
+typedef struct AsyncLogFileHeader {
+	char magic[8]; /**< MCC_LOG_MAGIC */
+	uint32_T version; /**< MCC_LOG_VERSION */
+	uint32_T recordSize; /**< sizeof(AsyncLogRecord) of the writer */
+	uint32_T stringSize; /**< MCC_LOG_STRING_SIZE of the writer */
+	uint32_T reserved;
+} AsyncLogFileHeader;
+
+/**
+ * @brief A single logged message
+ */
+typedef struct AsyncLogRecord {
+	uint64_T timestamp; /**< CLOCK_MONOTONIC in ns, the SimulationClock with MCC_SIMULATION */
+	uint16_T format; /**< the identifier of the format */
+	uint16_T thread; /**< the number of the logging thread, in the order of their first message */
+	uint16_T slots; /**< the number of used argument slots */
+	uint16_T reserved;
+	uint64_T args[MCC_LOG_MAX_ARGS]; /**< the arguments in the order of the format, strings take several slots */
+} AsyncLogRecord;
+
+/**
+ * @brief Starts writing the log into a file, the file is overwritten
+ * @return 0 on success, otherwise -1
+ */
+int AsyncLog_open(const char* path);
+
+/**
+ * @brief Logs a message, never blocks once the log is open
+ * @details If the ring of the thread is full, the message is dropped and counted. Use MCC_LOG instead
+ */
+void AsyncLog_write(AsyncLogFormat* format, ...);
+
+/**
+ * @brief Writes all logged messages and closes the file
+ */
+void AsyncLog_close(void);
+
+/**
+ * @brief The number of messages dropped because the ring of their thread was full
+ */
+uint64_T AsyncLog_getDropped(void);
+
+/**
+ * @brief Splits a format into its conversions
+ * @details Used by the writer and the decoder: returns the length of the text up to and including the next
+ * conversion, which needs an argument, and stores its kind; the length of the rest if there is none, then kind is -1
+ */
+size_t AsyncLog_nextConversion(const char* format, int* kind);
+
+#ifdef MCC_ASYNC_LOG
+#define MCC_LOG(fmt, ...) do { \
+	static AsyncLogFormat mcc_log_format = { .format = fmt }; \
+	AsyncLog_write(&mcc_log_format, ##__VA_ARGS__); \
+} while (0)
+#else
+#define MCC_LOG(...) printf(__VA_ARGS__)
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* ASYNCLOG_H_ */
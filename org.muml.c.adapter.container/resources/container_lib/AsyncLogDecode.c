@@ -0,0 +1,159 @@
+/*
+ * AsyncLogDecode.c
+ *
+ * Prints a log written with MCC_ASYNC_LOG as text: logdecode log.bin
+ * Every message is prefixed with its timestamp in s and the number of its thread.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "AsyncLog.h"
+
+static char* formats[MCC_LOG_MAX_FORMATS];
+
+/*
+ * Prints the text of a format, %% as %
+ */
+static void printText(const char* text, size_t length) {
+	size_t i;
+	for (i = 0; i < length; i++) {
+		putchar(text[i]);
+		if (text[i] == '%' && i + 1 < length && text[i + 1] == '%') {
+			i++;
+		}
+	}
+}
+
+/*
+ * The start of the conversion at the end of a segment of AsyncLog_nextConversion
+ */
+static size_t conversionStart(const char* segment, size_t length) {
+	size_t start = length - 1;
+	while (start > 0 && segment[start] != '%') {
+		start--;
+	}
+	return start;
+}
+
+/*
+ * Prints one conversion of a format with the argument of its slot. The length modifier is replaced,
+ * because the slots hold 64 bit values independent of the ECU the log was written on
+ */
+static void printConversion(const char* segment, size_t length, int kind, const uint64_T* slot) {
+	char spec[64];
+	size_t text = conversionStart(segment, length);
+	size_t n = 0;
+	size_t i;
+	double value;
+
+	printText(segment, text);
+	for (i = text; i < length - 1 && n < sizeof(spec) - 4; i++) {
+		if (strchr("hlzjt", segment[i]) == NULL) {
+			spec[n++] = segment[i];
+		}
+	}
+	if (kind == LOG_ARG_LONG || kind == LOG_ARG_LLONG) {
+		spec[n++] = 'l';
+		spec[n++] = 'l';
+	}
+	spec[n++] = segment[length - 1];
+	spec[n] = '\0';
+	switch (kind) {
+	case LOG_ARG_INT:
+		printf(spec, (int) *slot);
+		break;
+	case LOG_ARG_LONG:
+	case LOG_ARG_LLONG:
+		printf(spec, (long long) *slot);
+		break;
+	case LOG_ARG_POINTER:
+		printf("0x%llx", (unsigned long long) *slot);
+		break;
+	case LOG_ARG_DOUBLE:
+		memcpy(&value, slot, sizeof(value));
+		printf(spec, value);
+		break;
+	default:
+		printf(spec, (const char*) slot);
+		break;
+	}
+}
+
+static void printRecord(const AsyncLogRecord* record) {
+	const char* format = formats[record->format];
+	const char* segment;
+	size_t length;
+	uint16_T used = 0;
+	int kind;
+
+	printf("[%llu.%09llu %u] ", (unsigned long long) (record->timestamp / 1000000000u),
+			(unsigned long long) (record->timestamp % 1000000000u), (unsigned) record->thread);
+	if (format == NULL) {
+		printf("unknown format %u\n", (unsigned) record->format);
+		return;
+	}
+	for (segment = format; *segment != '\0'; segment += length) {
+		length = AsyncLog_nextConversion(segment, &kind);
+		if (kind < 0) {
+			printText(segment, length);
+			continue;
+		}
+		if (used + (kind == LOG_ARG_STRING ? MCC_LOG_STRING_SIZE / 8 : 1) > record->slots) {
+			//the argument did not fit into the record
+			printText(segment, conversionStart(segment, length));
+			putchar('?');
+			continue;
+		}
+		printConversion(segment, length, kind, &record->args[used]);
+		used += kind == LOG_ARG_STRING ? MCC_LOG_STRING_SIZE / 8 : 1;
+	}
+}
+
+int main(int argc, char** argv) {
+	AsyncLogFileHeader header;
+	AsyncLogRecord record;
+	FILE* file;
+	uint32_T tag;
+	uint16_T id;
+	uint16_T length;
+
+	if (argc < 2) {
+		printf("usage: %s <log file>\n", argv[0]);
+		return 1;
+	}
+	file = fopen(argv[1], "rb");
+	if (file == NULL) {
+		printf("logdecode: cannot open %s\n", argv[1]);
+		return 1;
+	}
+	if (fread(&header, sizeof(header), 1, file) != 1 || memcmp(header.magic, MCC_LOG_MAGIC, sizeof(header.magic)) != 0) {
+		printf("logdecode: %s is no log file\n", argv[1]);
+		return 1;
+	}
+	if (header.version != MCC_LOG_VERSION || header.recordSize != sizeof(AsyncLogRecord)
+			|| header.stringSize != MCC_LOG_STRING_SIZE) {
+		printf("logdecode: %s was written with another format\n", argv[1]);
+		return 1;
+	}
+	while (fread(&tag, sizeof(tag), 1, file) == 1) {
+		if (tag == LOG_ENTRY_FORMAT) {
+			if (fread(&id, sizeof(id), 1, file) != 1 || fread(&length, sizeof(length), 1, file) != 1
+					|| id >= MCC_LOG_MAX_FORMATS) {
+				break;
+			}
+			free(formats[id]);
+			formats[id] = calloc(length + 1u, 1);
+			if (formats[id] == NULL || fread(formats[id], 1, length, file) != length) {
+				break;
+			}
+		} else if (tag == LOG_ENTRY_RECORD && fread(&record, sizeof(record), 1, file) == 1
+				&& record.format < MCC_LOG_MAX_FORMATS) {
+			printRecord(&record);
+		} else {
+			printf("logdecode: %s is truncated\n", argv[1]);
+			break;
+		}
+	}
+	fclose(file);
+	return 0;
+}
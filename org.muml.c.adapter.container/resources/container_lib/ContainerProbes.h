@@ -0,0 +1,40 @@
+/**
+ * @file
+ * @brief Static tracepoints of the container runtime
+ * @details If <sys/sdt.h> of SystemTap is available, the probes are compiled as USDT probes of the provider mcc:
+ * a single nop in the code plus a note in the ELF file, which perf or bpftrace can attach to in a running ECU,
+ * e.g. bpftrace -l 'usdt:./app:mcc:*'. The arguments are only read while a probe is attached.
+ * Define MCC_NO_USDT to compile the probes to nothing. container_lib/queue_latency.bt measures with them how long
+ * messages wait in the MessageBuffers.
+ *
+ * Probes and arguments:
+ * - publish_entry(bufferID, msgID, msg), publish_return(bufferID, msgID, delivered, droppedMask)
+ * - enqueue(buf, slot, count), enqueue_conflate(buf, slot), enqueue_overwrite(buf, slot), enqueue_drop(buf, msg)
+ * - dequeue(buf, slot, count), where slot is the address of the message in the ring of the MessageBuffer
+ * - dds_write(writer, msgID), dds_take(reader, msgID), dds_async_write(writer, ring)
+ * - dds_local_write(writer, msgID), dds_local_take(port, msgID) of a message exchanged on the ECU without DDS
+ * - frame_overrun(lateNs, overruns) of a minor frame of the cyclic executive, which ended too late
+ * - dds_publication_matched(writer, portHandle), dds_liveliness_lost(writer, portHandle),
+ *   dds_liveliness_changed(reader, portHandle), dds_subscription_matched(reader, portHandle)
+ */
+#ifndef CONTAINERPROBES_H_
+#define CONTAINERPROBES_H_
+
+#if !defined(MCC_NO_USDT) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define MCC_USDT 1
+#endif
+#endif
+
+#ifdef MCC_USDT
+#define MCC_PROBE2(name, a1, a2) DTRACE_PROBE2(mcc, name, a1, a2)
+#define MCC_PROBE3(name, a1, a2, a3) DTRACE_PROBE3(mcc, name, a1, a2, a3)
+#define MCC_PROBE4(name, a1, a2, a3, a4) DTRACE_PROBE4(mcc, name, a1, a2, a3, a4)
+#else
+#define MCC_PROBE2(name, a1, a2)
+#define MCC_PROBE3(name, a1, a2, a3)
+#define MCC_PROBE4(name, a1, a2, a3, a4)
+#endif
+
+#endif /* CONTAINERPROBES_H_ */
@@ -7,12 +7,24 @@
 extern "C" {
 #endif
 
+//optional header of the ECU, which configures the container (e.g. -DMCC_CONFIG_HEADER=\"mcc_config.h\")
+#ifdef MCC_CONFIG_HEADER
+#include MCC_CONFIG_HEADER
+#endif
+
 //FIXME: Global for all Container (e.g. Lib_Container)
 #include "../lib/port.h"
 #include "MessageBuffer.h"
 
 
 
+/**
+ * @brief A predicate on the messages a MessageBuffer of a port accepts, msg points to the MUML message
+ * @details Generated for a receiver MessageBuffer, if the MCC_CONFIG_HEADER defines its filter. It is evaluated by
+ * the publishing thread, so it must not have side effects and may be called more than once per message
+ */
+typedef bool_t (*MessageFilter)(const void* msg);
+
 //FIXME: HandleTypes
 typedef enum {
 	PORT_HANDLE_TYPE_DDS, PORT_HANDLE_TYPE_LOCAL
@@ -0,0 +1,84 @@
+/*
+ * CyclicExecutive.c
+ *
+ * The dispatcher sleeps to absolute points in time of CLOCK_MONOTONIC, so the time of a frame does not drift
+ * with the execution time of the steps.
+ */
+#include <time.h>
+#include "CyclicExecutive.h"
+#include "ContainerProbes.h"
+#include "AsyncLog.h"
+
+static uint64_T overruns = 0;
+
+int CyclicExecutive_check(const CyclicSlot* slots, uint32_T count, uint32_T frames, uint64_T minorFrame) {
+	uint64_T load;
+	uint64_T maxLoad = 0;
+	uint32_T frame;
+	uint32_T i;
+	int status = 0;
+
+	for (i = 0; i < count; i++) {
+		if (slots[i].rate == 0 || frames % slots[i].rate != 0 || slots[i].offset >= slots[i].rate) {
+			MCC_LOG("cyclic executive: rate %u and offset %u of %s do not fit into %u frames\n",
+					(unsigned) slots[i].rate, (unsigned) slots[i].offset, slots[i].name, (unsigned) frames);
+			return -1;
+		}
+		MCC_LOG("cyclic executive: %s every %llu ns from frame %u, wcet %llu ns\n", slots[i].name,
+				(unsigned long long) (slots[i].rate * minorFrame), (unsigned) slots[i].offset,
+				(unsigned long long) slots[i].wcet);
+	}
+	for (frame = 0; frame < frames; frame++) {
+		load = 0;
+		for (i = 0; i < count; i++) {
+			if (CyclicSlot_runs(&slots[i], frame)) {
+				load += slots[i].wcet;
+			}
+		}
+		if (load > minorFrame) {
+			MCC_LOG("cyclic executive: frame %u needs %llu ns of %llu ns\n", (unsigned) frame,
+					(unsigned long long) load, (unsigned long long) minorFrame);
+			status = -1;
+		}
+		maxLoad = load > maxLoad ? load : maxLoad;
+	}
+	MCC_LOG("cyclic executive: %u frames of %llu ns, at most %llu ns used\n", (unsigned) frames,
+			(unsigned long long) minorFrame, (unsigned long long) maxLoad);
+	return status;
+}
+
+static void advance(struct timespec* t, uint64_T ns) {
+	uint64_T nsec = (uint64_T) t->tv_nsec + ns;
+	t->tv_sec += (time_t) (nsec / 1000000000u);
+	t->tv_nsec = (long) (nsec % 1000000000u);
+}
+
+static uint64_T toNs(const struct timespec* t) {
+	return (uint64_T) t->tv_sec * 1000000000u + (uint64_T) t->tv_nsec;
+}
+
+void CyclicExecutive_run(void (*step)(void), uint64_T minorFrame) {
+	struct timespec next;
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &next);
+	for (;;) {
+		step();
+		advance(&next, minorFrame);
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		if (toNs(&now) > toNs(&next)) {
+			__atomic_store_n(&overruns, overruns + 1, __ATOMIC_RELAXED);
+			MCC_PROBE2(frame_overrun, toNs(&now) - toNs(&next), overruns);
+			if (toNs(&now) - toNs(&next) >= minorFrame) {
+				//a whole frame was missed: restart the schedule from now instead of running late frames back to back
+				next = now;
+			}
+			continue;
+		}
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+	}
+}
+
+uint64_T CyclicExecutive_getOverruns(void) {
+	return __atomic_load_n(&overruns, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,70 @@
+/**
+ * @file
+ * @brief Time-triggered execution of the component instances of an ECU
+ * @details If the ECU is compiled with MCC_CYCLIC_EXECUTIVE, main.c does not step the component instances in a
+ * free-running loop. The major frame of MCC_CYCLIC_FRAMES minor frames of MCC_CYCLIC_MINOR_FRAME_NS each is
+ * repeated; a component instance runs in the minor frames f with f % rate == offset, as given by its CyclicSlot
+ * in the constant schedule of main.c. The step of the ECU executes one minor frame and the dispatcher sleeps until
+ * the start of the next one, so the instances start at fixed points in time and a message waits at most the period
+ * of its receiver plus one minor frame.
+ */
+#ifndef CYCLICEXECUTIVE_H_
+#define CYCLICEXECUTIVE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "standardTypes.h"
+
+#ifndef MCC_CYCLIC_MINOR_FRAME_NS
+#define MCC_CYCLIC_MINOR_FRAME_NS 1000000 /**< the length of a minor frame */
+#endif
+
+#ifndef MCC_CYCLIC_FRAMES
+#define MCC_CYCLIC_FRAMES 1 /**< the minor frames of the major frame, a multiple of the rate of every instance */
+#endif
+
+/**
+ * @brief The place of a component instance in the schedule
+ */
+typedef struct CyclicSlot {
+	const char* name; /**< the component instance */
+	uint32_T rate; /**< the instance runs every rate minor frames */
+	uint32_T offset; /**< the first minor frame the instance runs in, less than rate */
+	uint64_T wcet; /**< the worst-case execution time of a step of the instance in ns, 0 if unknown */
+} CyclicSlot;
+
+/**
+ * @brief Whether a component instance runs in a minor frame
+ */
+static inline bool_t CyclicSlot_runs(const CyclicSlot* slot, uint32_T frame) {
+	return frame % slot->rate == slot->offset;
+}
+
+/**
+ * @brief Checks a schedule and prints it
+ * @details Every rate has to divide the number of frames, every offset has to be less than its rate and the WCETs
+ * of the instances of a minor frame have to fit into it
+ *
+ * @return 0 if the schedule is feasible, otherwise -1
+ */
+int CyclicExecutive_check(const CyclicSlot* slots, uint32_T count, uint32_T frames, uint64_T minorFrame);
+
+/**
+ * @brief Executes a minor frame every minorFrame ns, never returns
+ * @details step executes the instances of the current minor frame. A frame which ends after the start of the next
+ * one is an overrun: the next frame starts at once, and if a whole frame was missed, the schedule restarts from now
+ * instead of catching up
+ */
+void CyclicExecutive_run(void (*step)(void), uint64_T minorFrame);
+
+/**
+ * @brief The number of minor frames, which ended too late
+ */
+uint64_T CyclicExecutive_getOverruns(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* CYCLICEXECUTIVE_H_ */
@@ -1,6 +1,752 @@
+#include <pthread.h>
+#include <math.h>
+#include <time.h>
 #include "DDS_Custom_Lib.h"
+#include "ContainerProbes.h"
+#include "AsyncLog.h"
+#ifdef MCC_SIMULATION
+#include "SimulationClock.h"
+#endif
 
-const DDSHandle INIT_DDSHandle = { NULL, NULL, NULL, 0, 0 };
+const DDSHandle INIT_DDSHandle = { NULL, NULL, NULL, 0, 0, 0, NULL, false, 0.0, 0, NULL, 0 };
+
+typedef char outbound_ring_size_is_power_of_two[(MCC_DDS_ASYNC_RING_SIZE & (MCC_DDS_ASYNC_RING_SIZE - 1)) == 0 ? 1 : -1];
+typedef char local_route_readers_fit_targets[MCC_DDS_LOCAL_ROUTE_READERS <= 32 ? 1 : -1];
+
+//the outbound rings served by the sender thread, guarded by sender_lock. The sender thread drains a snapshot
+//of the list without the lock, a ring is only freed after the passes holding it have released it
+static DDSOutboundRing* sender_rings = NULL;
+static pthread_mutex_t sender_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t ring_released = PTHREAD_COND_INITIALIZER;
+static pthread_t sender_thread;
+static bool_t sender_running = false;
+
+struct participant_node {
+	DDS_DomainParticipant* participant;
+	DDS_DomainId_t domainID;
+	DDSTransportKind transport;
+	DDS_Long receiveThreadPriority;
+	unsigned int refCount;
+	int state; /**< ENTITY_CREATING while the first thread creates the participant, then ENTITY_READY or ENTITY_FAILED */
+	struct participant_node *next;
+};
+
+//a Topic or ContentFilteredTopic of a shared participant, created once by the first port using its name
+struct topic_node {
+	DDS_DomainParticipant* participant;
+	char* name;
+	DDS_TopicDescription* description;
+	int state;
+	struct topic_node *next;
+};
+
+enum { ENTITY_CREATING, ENTITY_READY, ENTITY_FAILED };
+
+//participant_lock only guards the lists: the DDS entities are created outside of it, so ports of different
+//participants or topics are built in parallel, and ports waiting for the same entity wait on entity_created
+static struct participant_node *participant_list = NULL;
+static struct topic_node *topic_list = NULL;
+static pthread_mutex_t participant_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t entity_created = PTHREAD_COND_INITIALIZER;
+
+/*
+ * Drops a reference to a participant node, the last one unlinks it. Called with participant_lock held
+ */
+static struct participant_node* unreferenceParticipant(struct participant_node* node) {
+	struct participant_node **lst;
+	struct topic_node **topics;
+	struct topic_node *topic;
+
+	if (--node->refCount > 0) {
+		return NULL;
+	}
+	for (lst = &participant_list; *lst != node; lst = &(*lst)->next) {
+	}
+	*lst = node->next;
+	for (topics = &topic_list; *topics != NULL;) {
+		topic = *topics;
+		if (topic->participant == node->participant) {
+			*topics = topic->next;
+			free(topic->name);
+			free(topic);
+		} else {
+			topics = &topic->next;
+		}
+	}
+	return node;
+}
+
+DDS_DomainParticipant* DDSParticipant_acquire(DDS_DomainId_t domainID, const struct DDS_DomainParticipantQos* qos, const DDSQoSProfile* profile) {
+	DDSTransportKind transport = profile != NULL ? profile->transport : DDS_TRANSPORT_DEFAULT;
+	DDS_Long priority = profile != NULL ? profile->receiveThreadPriority : MCC_DDS_THREAD_PRIORITY_DEFAULT;
+	struct participant_node *node;
+	struct participant_node *unused;
+	DDS_DomainParticipant* participant = NULL;
+
+	pthread_mutex_lock(&participant_lock);
+	for (node = participant_list; node != NULL; node = node->next) {
+		if (node->domainID == domainID && node->transport == transport
+				&& node->receiveThreadPriority == priority && node->state != ENTITY_FAILED) {
+			node->refCount++;
+			while (node->state == ENTITY_CREATING) {
+				pthread_cond_wait(&entity_created, &participant_lock);
+			}
+			participant = node->participant;
+			unused = node->state == ENTITY_READY ? NULL : unreferenceParticipant(node);
+			pthread_mutex_unlock(&participant_lock);
+			free(unused);
+			return participant;
+		}
+	}
+	node = malloc(sizeof(struct participant_node));
+	if (node == NULL) {
+		pthread_mutex_unlock(&participant_lock);
+		return NULL;
+	}
+	node->participant = NULL;
+	node->domainID = domainID;
+	node->transport = transport;
+	node->receiveThreadPriority = priority;
+	node->refCount = 1;
+	node->state = ENTITY_CREATING;
+	node->next = participant_list;
+	participant_list = node;
+	pthread_mutex_unlock(&participant_lock);
+
+	participant = DDS_DomainParticipantFactory_create_participant(
+			DDS_TheParticipantFactory, domainID, qos, NULL /* listener */, DDS_STATUS_MASK_NONE);
+
+	pthread_mutex_lock(&participant_lock);
+	node->participant = participant;
+	node->state = participant != NULL ? ENTITY_READY : ENTITY_FAILED;
+	unused = participant != NULL ? NULL : unreferenceParticipant(node);
+	pthread_cond_broadcast(&entity_created);
+	pthread_mutex_unlock(&participant_lock);
+	free(unused);
+	return participant;
+}
+
+void DDSParticipant_release(DDS_DomainParticipant* participant) {
+	struct participant_node *node;
+	struct participant_node *unused = NULL;
+
+	pthread_mutex_lock(&participant_lock);
+	for (node = participant_list; node != NULL; node = node->next) {
+		if (node->participant == participant) {
+			unused = unreferenceParticipant(node);
+			break;
+		}
+	}
+	pthread_mutex_unlock(&participant_lock);
+	if (unused != NULL) {
+		publisher_shutdown(unused->participant);
+		free(unused);
+	}
+}
+
+/*
+ * Returns the topic node of a name and its entity, waiting while another thread creates it. If the entity does not
+ * exist yet, creator is set and the calling thread has to create it and to pass it to publishTopic
+ */
+static struct topic_node* claimTopic(DDS_DomainParticipant* participant, const char* name, bool_t* creator,
+		DDS_TopicDescription** description) {
+	struct topic_node *node;
+	size_t length;
+
+	*creator = false;
+	*description = NULL;
+	pthread_mutex_lock(&participant_lock);
+	for (node = topic_list; node != NULL; node = node->next) {
+		if (node->participant == participant && strcmp(node->name, name) == 0) {
+			break;
+		}
+	}
+	if (node == NULL) {
+		length = strlen(name) + 1;
+		node = malloc(sizeof(struct topic_node));
+		if (node != NULL && (node->name = malloc(length)) == NULL) {
+			free(node);
+			node = NULL;
+		}
+		if (node == NULL) {
+			pthread_mutex_unlock(&participant_lock);
+			return NULL;
+		}
+		memcpy(node->name, name, length);
+		node->participant = participant;
+		node->description = NULL;
+		node->state = ENTITY_FAILED;
+		node->next = topic_list;
+		topic_list = node;
+	}
+	while (node->state == ENTITY_CREATING) {
+		pthread_cond_wait(&entity_created, &participant_lock);
+	}
+	if (node->state == ENTITY_FAILED) {
+		//a new node, or the creation failed before: try again
+		node->state = ENTITY_CREATING;
+		*creator = true;
+	}
+	*description = node->description;
+	pthread_mutex_unlock(&participant_lock);
+	return node;
+}
+
+static void publishTopic(struct topic_node* node, DDS_TopicDescription* description) {
+	pthread_mutex_lock(&participant_lock);
+	node->description = description;
+	node->state = description != NULL ? ENTITY_READY : ENTITY_FAILED;
+	pthread_cond_broadcast(&entity_created);
+	pthread_mutex_unlock(&participant_lock);
+}
+
+DDS_Topic* DDSParticipant_getTopic(DDS_DomainParticipant* participant, const char* topicName, const char* typeName,
+		DDS_ReturnCode_t (*registerType)(DDS_DomainParticipant*, const char*)) {
+	DDS_ReturnCode_t retcode;
+	DDS_TopicDescription* description;
+	DDS_Topic* topic = NULL;
+	struct topic_node* node;
+	bool_t creator;
+
+	retcode = registerType(participant, typeName);
+	if (retcode != DDS_RETCODE_OK) {
+		MCC_LOG("register_type error %d\n", retcode);
+		return NULL;
+	}
+	node = claimTopic(participant, topicName, &creator, &description);
+	if (node == NULL) {
+		return NULL;
+	}
+	if (creator) {
+		description = DDS_DomainParticipant_lookup_topicdescription(participant, topicName);
+		if (description != NULL) {
+			topic = DDS_Topic_narrow(description);
+		} else {
+			topic = DDS_DomainParticipant_create_topic(participant, topicName, typeName,
+					&DDS_TOPIC_QOS_DEFAULT, NULL /* listener */, DDS_STATUS_MASK_NONE);
+		}
+		publishTopic(node, topic != NULL ? DDS_Topic_as_topicdescription(topic) : NULL);
+	} else if (description != NULL) {
+		topic = DDS_Topic_narrow(description);
+	}
+	if (topic == NULL) {
+		MCC_LOG("create_topic error\n");
+	}
+	return topic;
+}
+
+DDS_TopicDescription* DDSParticipant_getFilteredTopic(DDS_DomainParticipant* participant, DDS_Topic* topic,
+		const char* name, const char* expression) {
+	struct DDS_StringSeq parameters = DDS_SEQUENCE_INITIALIZER;
+	DDS_TopicDescription* description = NULL;
+	DDS_ContentFilteredTopic* filtered;
+	struct topic_node* node;
+	bool_t creator;
+
+	node = claimTopic(participant, name, &creator, &description);
+	if (node == NULL) {
+		return NULL;
+	}
+	if (creator) {
+		description = DDS_DomainParticipant_lookup_topicdescription(participant, name);
+		if (description == NULL) {
+			filtered = DDS_DomainParticipant_create_contentfilteredtopic(participant, name, topic, expression, &parameters);
+			description = filtered != NULL ? DDS_ContentFilteredTopic_as_topicdescription(filtered) : NULL;
+		}
+		publishTopic(node, description);
+	}
+	if (description == NULL) {
+		MCC_LOG("create_contentfilteredtopic %s error\n", name);
+	}
+	return description;
+}
+
+/*
+ * Writes up to max samples of a ring. Consecutive samples of the same DataWriter are flushed together,
+ * so a batching writer sends them in one message
+ */
+static uint32_T drainRing(DDSOutboundRing* ring, uint32_T max) {
+	uint32_T head = ring->head;
+	uint32_T tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+	uint32_T n = 0;
+	DDSOutboundSample* slot;
+	while (head != tail && n < max) {
+		slot = &ring->slots[head & (MCC_DDS_ASYNC_RING_SIZE - 1)];
+		MCC_PROBE2(dds_async_write, slot->writer, ring);
+		slot->write(slot->writer, slot->data.bytes);
+		head++;
+		n++;
+		if (head == tail || n == max || ring->slots[head & (MCC_DDS_ASYNC_RING_SIZE - 1)].writer != slot->writer) {
+			DDS_DataWriter_flush(slot->writer);
+		}
+	}
+	__atomic_store_n(&ring->head, head, __ATOMIC_RELEASE);
+	return n;
+}
+
+/*
+ * Takes the rings of a pass of the sender thread, called with sender_lock held
+ */
+static size_t snapshotRings(DDSOutboundRing*** snapshot, size_t* capacity) {
+	DDSOutboundRing* ring;
+	DDSOutboundRing** grown;
+	size_t count = 0;
+	for (ring = sender_rings; ring != NULL; ring = ring->next) {
+		if (count == *capacity) {
+			grown = realloc(*snapshot, (*capacity > 0 ? *capacity * 2 : 8) * sizeof(DDSOutboundRing*));
+			if (grown == NULL) {
+				//the remaining rings are served by the next pass
+				break;
+			}
+			*snapshot = grown;
+			*capacity = *capacity > 0 ? *capacity * 2 : 8;
+		}
+		ring->users++;
+		(*snapshot)[count++] = ring;
+	}
+	return count;
+}
+
+static void* sender_main(void* arg) {
+	DDSOutboundRing** snapshot = NULL;
+	size_t capacity = 0;
+	size_t count;
+	size_t i;
+	uint32_T written;
+	struct timespec idle = { MCC_DDS_ASYNC_IDLE_NS / 1000000000, MCC_DDS_ASYNC_IDLE_NS % 1000000000 };
+	for (;;) {
+		written = 0;
+		pthread_mutex_lock(&sender_lock);
+		if (!sender_running) {
+			pthread_mutex_unlock(&sender_lock);
+			free(snapshot);
+			return NULL;
+		}
+		count = snapshotRings(&snapshot, &capacity);
+		pthread_mutex_unlock(&sender_lock);
+		//a blocking write only delays this thread, ports are still added and removed meanwhile
+		for (i = 0; i < count; i++) {
+			written += drainRing(snapshot[i], MCC_DDS_ASYNC_BATCH);
+			pthread_mutex_lock(&sender_lock);
+			if (--snapshot[i]->users == 0) {
+				pthread_cond_broadcast(&ring_released);
+			}
+			pthread_mutex_unlock(&sender_lock);
+		}
+		if (written == 0) {
+			nanosleep(&idle, NULL);
+		}
+	}
+}
+
+int DDSHandle_enableAsyncSend(DDSHandle* hndl) {
+	DDSOutboundRing* ring = Placement_allocCacheAligned(sizeof(DDSOutboundRing));
+	int status = 0;
+	if (ring == NULL) {
+		return -1;
+	}
+	pthread_mutex_lock(&sender_lock);
+	if (!sender_running) {
+		sender_running = pthread_create(&sender_thread, NULL, &sender_main, NULL) == 0;
+	}
+	if (sender_running) {
+		ring->users = 0;
+		ring->next = sender_rings;
+		sender_rings = ring;
+		hndl->outbound = ring;
+	} else {
+		MCC_LOG("create sender thread error\n");
+		free(ring);
+		status = -1;
+	}
+	pthread_mutex_unlock(&sender_lock);
+	return status;
+}
+
+/*
+ * Removes the ring of a port from the sender thread and writes its remaining samples,
+ * the last ring stops the sender thread
+ */
+static void disableAsyncSend(DDSHandle* hndl) {
+	DDSOutboundRing** ring;
+	bool_t stop = false;
+	pthread_mutex_lock(&sender_lock);
+	for (ring = &sender_rings; *ring != NULL; ring = &(*ring)->next) {
+		if (*ring == hndl->outbound) {
+			*ring = hndl->outbound->next;
+			break;
+		}
+	}
+	//only waits for the sender thread draining this ring, which would be drained here anyway
+	while (hndl->outbound->users > 0) {
+		pthread_cond_wait(&ring_released, &sender_lock);
+	}
+	if (sender_rings == NULL && sender_running) {
+		sender_running = false;
+		stop = true;
+	}
+	pthread_mutex_unlock(&sender_lock);
+	if (stop) {
+		pthread_join(sender_thread, NULL);
+	}
+	while (drainRing(hndl->outbound, MCC_DDS_ASYNC_RING_SIZE) > 0) {
+	}
+	free(hndl->outbound);
+	hndl->outbound = NULL;
+}
+
+struct DDSLocalRoute {
+	DDS_DomainId_t domainID;
+	char* partition;
+	char* topic;
+	size_t elementSize; /**< the size of the MUML message of the Topic */
+	uint8_T writerCount;
+	uint8_T readerCount;
+	DDSLocalEndpoint* writers; /**< the writing ports, linked by DDSLocalEndpoint::next */
+	DDSLocalEndpoint* readers[MCC_DDS_LOCAL_ROUTE_READERS];
+	struct DDSLocalRoute* next;
+};
+
+//the local routes of the ECU, guarded by route_lock. Their ports only change while ports are built or shut down,
+//the targets of a writing port also change with the subscriptions of its DataWriter. No DDS entity is queried with
+//route_lock held, because DDS may hold its own locks while it calls PublisherListener_PublicationMatched
+static DDSLocalRoute* local_routes = NULL;
+static pthread_mutex_t route_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static char* duplicate(const char* string) {
+	char* copy = malloc(strlen(string) + 1);
+	if (copy != NULL) {
+		strcpy(copy, string);
+	}
+	return copy;
+}
+
+/*
+ * The route of a Topic, which is created on first use; called with route_lock held
+ */
+static DDSLocalRoute* findRoute(DDS_DomainId_t domainID, const char* partition, const char* topic, size_t elementSize) {
+	DDSLocalRoute* route;
+	for (route = local_routes; route != NULL; route = route->next) {
+		if (route->domainID == domainID && strcmp(route->partition, partition) == 0
+				&& strcmp(route->topic, topic) == 0) {
+			return route->elementSize == elementSize ? route : NULL;
+		}
+	}
+	route = calloc(1, sizeof(DDSLocalRoute));
+	if (route == NULL) {
+		return NULL;
+	}
+	route->domainID = domainID;
+	route->partition = duplicate(partition);
+	route->topic = duplicate(topic);
+	route->elementSize = elementSize;
+	if (route->partition == NULL || route->topic == NULL) {
+		free(route->partition);
+		free(route->topic);
+		free(route);
+		return NULL;
+	}
+	route->next = local_routes;
+	local_routes = route;
+	return route;
+}
+
+/*
+ * Unlinks and frees a route without ports; called with route_lock held
+ */
+static void deleteRoute(DDSLocalRoute* route) {
+	DDSLocalRoute** r;
+	for (r = &local_routes; *r != NULL; r = &(*r)->next) {
+		if (*r == route) {
+			*r = route->next;
+			break;
+		}
+	}
+	free(route->partition);
+	free(route->topic);
+	free(route);
+}
+
+/*
+ * Removes the reading port at index i of a route; called with route_lock held
+ */
+static void removeReader(DDSLocalRoute* route, uint8_T i) {
+	route->readers[i] = route->readers[route->readerCount - 1];
+	route->readerCount--;
+}
+
+/*
+ * Creates the MessageBuffer of a reading port, once the route of its Topic has a writer; called with route_lock held
+ */
+static int createBuffer(DDSLocalEndpoint* ep) {
+	MessageBuffer* buffer = MessageBuffer_create(MCC_DDS_LOCAL_ROUTE_CAPACITY, ep->route->elementSize, true);
+	if (buffer == NULL) {
+		MCC_LOG("local route of topic %s error, the port uses DDS only\n", ep->topic);
+		return -1;
+	}
+	__atomic_store_n(&ep->buffer, buffer, __ATOMIC_RELEASE);
+	return 0;
+}
+
+/*
+ * Resolves the subscriptions matched by a writing port to the reading ports of its route. The port sends locally only,
+ * if every subscription is a reading port of the route with a MessageBuffer; called with route_lock held
+ */
+static void updateTargets(DDSLocalEndpoint* ep) {
+	DDSLocalRoute* route = ep->route;
+	DDS_Long count = DDS_InstanceHandleSeq_get_length(&ep->matched);
+	uint32_T targets = 0;
+	uint32_T target;
+	DDS_Long m;
+	uint8_T i;
+
+	//without subscriptions, DDS keeps the message for late joiners according to the QoS of the DataWriter
+	for (m = 0; m < count; m++) {
+		target = 0;
+		for (i = 0; i < route->readerCount && target == 0; i++) {
+			if (route->readers[i]->buffer != NULL
+					&& DDS_InstanceHandle_equals(DDS_InstanceHandleSeq_get_reference(&ep->matched, m), &route->readers[i]->handle)) {
+				target = 1u << i;
+			}
+		}
+		if (target == 0) {
+			//any other subscription is on another ECU and gets the message from DDS only
+			targets = 0;
+			break;
+		}
+		targets |= target;
+	}
+	__atomic_store_n(&ep->targets, targets, __ATOMIC_RELEASE);
+}
+
+/*
+ * Updates the targets of all writing ports of a route, after its reading ports changed; called with route_lock held
+ */
+static void updateRoute(DDSLocalRoute* route) {
+	DDSLocalEndpoint* ep;
+	for (ep = route->writers; ep != NULL; ep = ep->next) {
+		updateTargets(ep);
+	}
+}
+
+/*
+ * Takes the subscriptions matched by the DataWriter of a writing port into its targets. DDS calls the listener of a
+ * DataWriter from one thread at a time; a query of DDSHandle_routeLocally is dropped once the listener updated the port
+ */
+static void updateMatched(DDSHandle* hndl, DDS_DataWriter* writer, bool_t listener) {
+	struct DDS_InstanceHandleSeq matched = DDS_SEQUENCE_INITIALIZER;
+	struct DDS_InstanceHandleSeq previous;
+	DDSLocalEndpoint* ep = NULL;
+	uint8_T i;
+
+	if (DDS_DataWriter_get_matched_subscriptions(writer, &matched) != DDS_RETCODE_OK) {
+		DDS_InstanceHandleSeq_finalize(&matched);
+		return;
+	}
+	pthread_mutex_lock(&route_lock);
+	for (i = 0; i < hndl->localCount && ep == NULL; i++) {
+		if (hndl->local[i] != NULL && hndl->local[i]->writer == writer) {
+			ep = hndl->local[i];
+		}
+	}
+	if (ep != NULL && (listener || ep->updates == 0)) {
+		previous = ep->matched;
+		ep->matched = matched;
+		matched = previous;
+		ep->updates += listener ? 1 : 0;
+		updateTargets(ep);
+	}
+	pthread_mutex_unlock(&route_lock);
+	DDS_InstanceHandleSeq_finalize(&matched);
+}
+
+int DDSHandle_routeLocally(DDSHandle* hndl, uint8_T slot, DDS_DomainId_t domainID, const char* partition,
+		const char* topic, size_t elementSize, DDS_DataWriter* writer, DDS_DataReader* reader, MessageFilter filter) {
+	DDSLocalEndpoint* ep = calloc(1, sizeof(DDSLocalEndpoint));
+	DDSLocalRoute* route;
+	uint8_T i;
+	int status = -1;
+
+	if (ep == NULL || slot >= hndl->localCount) {
+		free(ep);
+		return -1;
+	}
+	ep->writer = writer;
+	ep->reader = reader;
+	if (reader != NULL) {
+		ep->handle = DDS_Entity_get_instance_handle(DDS_DataReader_as_entity(reader));
+	}
+	ep->filter = filter;
+	pthread_mutex_lock(&route_lock);
+	route = findRoute(domainID, partition, topic, elementSize);
+	if (route == NULL) {
+		MCC_LOG("local route of topic %s error, the port uses DDS only\n", topic);
+	} else if (ep->reader && route->readerCount == MCC_DDS_LOCAL_ROUTE_READERS) {
+		MCC_LOG("local route of topic %s exceeds MCC_DDS_LOCAL_ROUTE_READERS, the port uses DDS only\n", topic);
+	} else {
+		ep->topic = route->topic;
+		ep->route = route;
+		if (!ep->reader) {
+			//the first writer makes the route useful, the reading ports get their buffers now. A reading port
+			//without one stays on the route, the writers then send to DDS only
+			for (i = 0; route->writerCount == 0 && i < route->readerCount; i++) {
+				if (route->readers[i]->buffer == NULL) {
+					createBuffer(route->readers[i]);
+				}
+			}
+			ep->next = route->writers;
+			route->writers = ep;
+			route->writerCount++;
+			status = 0;
+		} else if (route->writerCount == 0 || createBuffer(ep) == 0) {
+			route->readers[route->readerCount++] = ep;
+			updateRoute(route);
+			status = 0;
+		}
+		if (status == 0) {
+			hndl->local[slot] = ep;
+		}
+	}
+	if (status != 0 && route != NULL && route->writerCount == 0 && route->readerCount == 0) {
+		deleteRoute(route);
+	}
+	pthread_mutex_unlock(&route_lock);
+	if (status != 0) {
+		free(ep);
+	} else if (ep->writer != NULL) {
+		//the subscriptions matched before the port was on its route
+		updateMatched(hndl, writer, false);
+	}
+	return status;
+}
+
+/*
+ * Whether the DataReaders of the new targets of a writing port took all samples DDS delivered to them, so a message
+ * sent locally now cannot overtake one of them
+ */
+static bool_t isDrained(DDSLocalEndpoint* ep, uint32_T targets) {
+	struct DDS_DataReaderCacheStatus status = DDS_DataReaderCacheStatus_INITIALIZER;
+	bool_t drained = true;
+	uint8_T i;
+
+	for (i = 0; drained && (targets >> i) != 0; i++) {
+		if ((targets & (1u << i)) != 0) {
+			drained = DDS_DataReader_get_datareader_cache_status(ep->route->readers[i]->reader, &status) == DDS_RETCODE_OK
+					&& status.sample_count == 0;
+		}
+	}
+	DDS_DataReaderCacheStatus_finalize(&status);
+	return drained;
+}
+
+bool_t DDSLocalEndpoint_send(DDSLocalEndpoint* ep, const void* msg) {
+	DDSLocalEndpoint* local;
+	uint32_T targets;
+	uint8_T i;
+
+	if (ep == NULL) {
+		return false;
+	}
+	targets = __atomic_load_n(&ep->targets, __ATOMIC_ACQUIRE);
+	//a reading port switching from DDS to the route keeps getting DDS samples until it took the earlier ones
+	if (targets != 0 && (targets & ~ep->delivered) != 0 && !isDrained(ep, targets & ~ep->delivered)) {
+		targets = 0;
+	}
+	ep->delivered = targets;
+	if (targets == 0) {
+		return false;
+	}
+	for (i = 0; targets != 0; i++, targets >>= 1) {
+		local = ep->route->readers[i];
+		if ((targets & 1u) != 0 && (local->filter == NULL || local->filter(msg))) {
+			MessageBuffer_enqueue(local->buffer, msg);
+		}
+	}
+	return true;
+}
+
+/*
+ * Removes a port from its local routes, a route without ports is deleted
+ */
+static void unrouteLocally(DDSHandle* hndl) {
+	DDSLocalEndpoint* ep;
+	DDSLocalEndpoint** w;
+	DDSLocalRoute* r;
+	uint8_T slot;
+	uint8_T i;
+
+	pthread_mutex_lock(&route_lock);
+	for (slot = 0; slot < hndl->localCount; slot++) {
+		ep = hndl->local[slot];
+		if (ep == NULL) {
+			continue;
+		}
+		hndl->local[slot] = NULL;
+		r = ep->route;
+		for (w = &r->writers; ep->writer != NULL && *w != NULL; w = &(*w)->next) {
+			if (*w == ep) {
+				*w = ep->next;
+				r->writerCount--;
+				break;
+			}
+		}
+		for (i = 0; ep->reader && i < r->readerCount; i++) {
+			if (r->readers[i] == ep) {
+				removeReader(r, i);
+				updateRoute(r);
+				break;
+			}
+		}
+		if (r->writerCount == 0 && r->readerCount == 0) {
+			deleteRoute(r);
+		}
+		DDS_InstanceHandleSeq_finalize(&ep->matched);
+		MessageBuffer_destroy(ep->buffer);
+		free(ep);
+	}
+	pthread_mutex_unlock(&route_lock);
+}
+
+int DDSHandle_shutdown(DDSHandle* hndl) {
+	int status = 0;
+
+	if (hndl->localCount > 0) {
+		unrouteLocally(hndl);
+	}
+
+	if (hndl->outbound != NULL) {
+		disableAsyncSend(hndl);
+	}
+
+	if (hndl->publisher != NULL) {
+		if (DDS_Publisher_delete_contained_entities(hndl->publisher) != DDS_RETCODE_OK
+				|| DDS_DomainParticipant_delete_publisher(hndl->participant, hndl->publisher) != DDS_RETCODE_OK) {
+			MCC_LOG("delete_publisher error\n");
+			status = -1;
+		}
+		hndl->publisher = NULL;
+	}
+	if (hndl->subscriber != NULL) {
+		if (DDS_Subscriber_delete_contained_entities(hndl->subscriber) != DDS_RETCODE_OK
+				|| DDS_DomainParticipant_delete_subscriber(hndl->participant, hndl->subscriber) != DDS_RETCODE_OK) {
+			MCC_LOG("delete_subscriber error\n");
+			status = -1;
+		}
+		hndl->subscriber = NULL;
+	}
+	if (hndl->participant != NULL) {
+		DDSParticipant_release(hndl->participant);
+		hndl->participant = NULL;
+	}
+	return status;
+}
+
+void DDSHandle_destroy(DDSHandle* hndl) {
+	if (hndl != NULL) {
+		DDSHandle_shutdown(hndl);
+		free(hndl);
+	}
+}
 
 int publisher_shutdown(DDS_DomainParticipant *participant) {
 	DDS_ReturnCode_t retcode;
@@ -9,14 +755,14 @@ int publisher_shutdown(DDS_DomainParticipant *participant) {
 	if (participant != NULL) {
 		retcode = DDS_DomainParticipant_delete_contained_entities(participant);
 		if (retcode != DDS_RETCODE_OK) {
-			printf("delete_contained_entities error %d\n", retcode);
+			MCC_LOG("delete_contained_entities error %d\n", retcode);
 			status = -1;
 		}
 
 		retcode = DDS_DomainParticipantFactory_delete_participant(
 		DDS_TheParticipantFactory, participant);
 		if (retcode != DDS_RETCODE_OK) {
-			printf("delete_participant error %d\n", retcode);
+			MCC_LOG("delete_participant error %d\n", retcode);
 			status = -1;
 		}
 	}
@@ -28,7 +774,7 @@ int publisher_shutdown(DDS_DomainParticipant *participant) {
 	/*
 	 retcode = DDS_DomainParticipantFactory_finalize_instance();
 	 if (retcode != DDS_RETCODE_OK) {
-	 printf("finalize_instance error %d\n", retcode);
+	 MCC_LOG("finalize_instance error %d\n", retcode);
 	 status = -1;
 	 }
 	 */
@@ -44,14 +790,14 @@ int subscriber_shutdown(DDS_DomainParticipant *participant) {
 	if (participant != NULL) {
 		retcode = DDS_DomainParticipant_delete_contained_entities(participant);
 		if (retcode != DDS_RETCODE_OK) {
-			printf("delete_contained_entities error %d\n", retcode);
+			MCC_LOG("delete_contained_entities error %d\n", retcode);
 			status = -1;
 		}
 
 		retcode = DDS_DomainParticipantFactory_delete_participant(
 		DDS_TheParticipantFactory, participant);
 		if (retcode != DDS_RETCODE_OK) {
-			printf("delete_participant error %d\n", retcode);
+			MCC_LOG("delete_participant error %d\n", retcode);
 			status = -1;
 		}
 	}
@@ -63,7 +809,7 @@ int subscriber_shutdown(DDS_DomainParticipant *participant) {
 	/*
 	 retcode = DDS_DomainParticipantFactory_finalize_instance();
 	 if (retcode != DDS_RETCODE_OK) {
-	 printf("finalize_instance error %d\n", retcode);
+	 MCC_LOG("finalize_instance error %d\n", retcode);
 	 status = -1;
 	 }
 	 */
@@ -71,67 +817,148 @@ int subscriber_shutdown(DDS_DomainParticipant *participant) {
 	return status;
 }
 
+void DDSQoSProfile_applyParticipant(const DDSQoSProfile* profile, struct DDS_DomainParticipantQos* qos) {
+	if (profile == NULL) {
+		return;
+	}
+	switch (profile->transport) {
+	case DDS_TRANSPORT_SHMEM:
+		qos->transport_builtin.mask = DDS_TRANSPORTBUILTIN_SHMEM;
+		break;
+	case DDS_TRANSPORT_UDPV4:
+		qos->transport_builtin.mask = DDS_TRANSPORTBUILTIN_UDPv4;
+		break;
+	default:
+		break;
+	}
+	if (profile->receiveThreadPriority != MCC_DDS_THREAD_PRIORITY_DEFAULT) {
+		qos->receiver_pool.thread.priority = profile->receiveThreadPriority;
+	}
+}
+
+void DDSQoSProfile_applyWriter(const DDSQoSProfile* profile, struct DDS_DataWriterQos* qos) {
+	if (profile == NULL) {
+		return;
+	}
+	if (profile->batching) {
+		qos->batch.enable = DDS_BOOLEAN_TRUE;
+		qos->batch.max_samples = profile->batchMaxSamples;
+		qos->batch.max_data_bytes = profile->batchMaxDataBytes;
+		if (profile->batchFlushDelayNs > 0) {
+			qos->batch.max_flush_delay.sec = profile->batchFlushDelayNs / 1000000000;
+			qos->batch.max_flush_delay.nanosec = profile->batchFlushDelayNs % 1000000000;
+		}
+	}
+	if (profile->asyncPublish) {
+		qos->publish_mode.kind = DDS_ASYNCHRONOUS_PUBLISH_MODE_QOS;
+	}
+}
+
+static uint64_T now(void) {
+#ifdef MCC_SIMULATION
+	return SimulationClock_now();
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_T) ts.tv_sec * 1000000000u + (uint64_T) ts.tv_nsec;
+#endif
+}
+
+bool_t DDSHandle_shouldPublish(DDSHandle* hndl, double value) {
+	const DDSQoSProfile* profile = hndl->qos;
+	uint64_T time;
+	bool_t publish;
+	if (profile == NULL || profile->publishPolicy == DDS_PUBLISH_ALWAYS) {
+		return true;
+	}
+	time = now();
+	if (!hndl->published) {
+		publish = true;
+	} else if (profile->maxSilentPeriodNs > 0 && time - hndl->lastPublishTime >= profile->maxSilentPeriodNs) {
+		//the receivers get a value at least every silent period, so they can tell a constant value from a lost writer
+		publish = true;
+	} else {
+		switch (profile->publishPolicy) {
+		case DDS_PUBLISH_DEADBAND_ABSOLUTE:
+			publish = fabs(value - hndl->lastPublished) > profile->deadband;
+			break;
+		case DDS_PUBLISH_DEADBAND_RELATIVE:
+			publish = fabs(value - hndl->lastPublished) > profile->deadband * fabs(hndl->lastPublished);
+			break;
+		default:
+			publish = value != hndl->lastPublished;
+			break;
+		}
+	}
+	return publish;
+}
+
+void DDSHandle_markPublished(DDSHandle* hndl, double value) {
+	if (hndl->qos == NULL || hndl->qos->publishPolicy == DDS_PUBLISH_ALWAYS) {
+		return;
+	}
+	hndl->published = true;
+	hndl->lastPublished = value;
+	hndl->lastPublishTime = now();
+}
+
+/*
+ * The listeners are called from the threads of RTI while the component reads the status of its port,
+ * so counters and status are accessed atomically. The partition of the own Publisher and Subscriber is
+ * taken from the DDSHandle instead of copying the QoS in every callback.
+ */
+
+static void setPortStatus(PortHandle* p, PortStatus status) {
+	__atomic_store_n(&(p->port->status), status, __ATOMIC_RELEASE);
+}
+
 void PublisherListener_PublicationMatched(void *listener_data,	DDS_DataWriter *writer,	const struct DDS_PublicationMatchedStatus *status) {
 	PortHandle* p = (PortHandle*) listener_data;
 	DDSHandle* dds_handle = (DDSHandle*) p->concreteHandle;
-	DDS_SubscriptionBuiltinTopicData subscriptionData =
+	struct DDS_SubscriptionBuiltinTopicData subscriptionData =
 			DDS_SubscriptionBuiltinTopicData_INITIALIZER;
-	DDS_DataWriter_get_matched_subscription_data(writer, &subscriptionData,
-			&(status->last_subscription_handle));
-	struct DDS_PublisherQos pubQos = DDS_PublisherQos_INITIALIZER;
-	DDS_Publisher_get_qos(dds_handle->publisher, &pubQos);
-	if (subscriptionData.partition.name._length == pubQos.partition.name._length){
-	dds_handle->numOfWriterToMatch--;
-	if (dds_handle->numOfWriterToMatch == 0) {
-		p->port->status = PORT_ACTIVE;
+	MCC_PROBE2(dds_publication_matched, writer, p);
+	if (dds_handle->localCount > 0) {
+		updateMatched(dds_handle, writer, true);
 	}
+	if (DDS_DataWriter_get_matched_subscription_data(writer, &subscriptionData,
+			&(status->last_subscription_handle)) == DDS_RETCODE_OK
+			&& DDS_StringSeq_get_length(&subscriptionData.partition.name) == dds_handle->partitionCount) {
+		if (__atomic_sub_fetch(&(dds_handle->numOfWriterToMatch), 1, __ATOMIC_ACQ_REL) == 0) {
+			setPortStatus(p, PORT_ACTIVE);
+		}
 	}
 	DDS_SubscriptionBuiltinTopicData_finalize(&subscriptionData);
-
 }
 
 void PublisherListener_LivelinessLost(void *listener_data,	DDS_DataWriter *writer, const struct DDS_LivelinessLostStatus *status) {
-
-		PortHandle* p = (PortHandle*) listener_data;
-		DDSHandle* dds_handle = (DDSHandle*) p->concreteHandle;
-		struct DDS_PublisherQos pubQos = DDS_PublisherQos_INITIALIZER;
-		DDS_Publisher_get_qos(dds_handle->publisher, &pubQos);
-		//if (subscriptionData.partition.name._length != pubQos.partition.name._length)
-	//		return;
-		dds_handle->numOfWriterToMatch++;
-		p->port->status = PORT_CONNECTIONLOST;
-		DDS_PublisherQos_finalize(&pubQos);
-
-
+	PortHandle* p = (PortHandle*) listener_data;
+	DDSHandle* dds_handle = (DDSHandle*) p->concreteHandle;
+	MCC_PROBE2(dds_liveliness_lost, writer, p);
+	__atomic_add_fetch(&(dds_handle->numOfWriterToMatch), 1, __ATOMIC_ACQ_REL);
+	setPortStatus(p, PORT_CONNECTIONLOST);
 }
 
 void SubscriberListener_LivelinessChanged(void *listener_data,DDS_DataReader *reader,const struct DDS_LivelinessChangedStatus *status) {
-		PortHandle* p = (PortHandle*) listener_data;
-		DDSHandle* dds_handle = (DDSHandle*) p->concreteHandle;
-		DDS_PublicationBuiltinTopicData publishData =
-				DDS_PublicationBuiltinTopicData_INITIALIZER;
-		DDS_DataReader_get_matched_publication_data(reader, &publishData, &(status->last_publication_handle));
-		struct DDS_SubscriberQos subQos = DDS_SubscriberQos_INITIALIZER;
-		DDS_Subscriber_get_qos(dds_handle->subscriber, &subQos);
-		if (publishData.partition.name._length == subQos.partition.name._length){
-		dds_handle->numOfReaderToMatch--;
-		if (dds_handle->numOfReaderToMatch == 0) {
-			p->port->status = PORT_ACTIVE;
-		}
+	PortHandle* p = (PortHandle*) listener_data;
+	DDSHandle* dds_handle = (DDSHandle*) p->concreteHandle;
+	struct DDS_PublicationBuiltinTopicData publishData =
+			DDS_PublicationBuiltinTopicData_INITIALIZER;
+	MCC_PROBE2(dds_liveliness_changed, reader, p);
+	if (DDS_DataReader_get_matched_publication_data(reader, &publishData,
+			&(status->last_publication_handle)) == DDS_RETCODE_OK
+			&& DDS_StringSeq_get_length(&publishData.partition.name) == dds_handle->partitionCount) {
+		if (__atomic_sub_fetch(&(dds_handle->numOfReaderToMatch), 1, __ATOMIC_ACQ_REL) == 0) {
+			setPortStatus(p, PORT_ACTIVE);
 		}
-		DDS_PublicationBuiltinTopicData_finalize(&publishData);
-
-
+	}
+	DDS_PublicationBuiltinTopicData_finalize(&publishData);
 }
 
 void SubscriberListener_SubscriptionMatched(void *listener_data,DDS_DataReader *reader,	const struct DDS_SubscriptionMatchedStatus *status) {
-		PortHandle* p = (PortHandle*) listener_data;
-		DDSHandle* dds_handle = (DDSHandle*) p->concreteHandle;
-			struct DDS_SubscriberQos subQos = DDS_SubscriberQos_INITIALIZER;
-			DDS_Subscriber_get_qos(dds_handle->subscriber, &subQos);
-		//	if (publishData.partition.name._length != subQos.partition.name._length)
-		//		return;
-			dds_handle->numOfReaderToMatch++;
-			p->port->status = PORT_CONNECTIONLOST;
-			DDS_SubscriberQos_finalize(&subQos);
+	PortHandle* p = (PortHandle*) listener_data;
+	DDSHandle* dds_handle = (DDSHandle*) p->concreteHandle;
+	MCC_PROBE2(dds_subscription_matched, reader, p);
+	__atomic_add_fetch(&(dds_handle->numOfReaderToMatch), 1, __ATOMIC_ACQ_REL);
+	setPortStatus(p, PORT_CONNECTIONLOST);
 }
@@ -6,15 +6,221 @@ extern "C" {
 #endif
 
 
+#include <stddef.h>
+#include <string.h>
 #include "ndds/ndds_c.h"
 #include "ContainerTypes.h"
+
+/*
+ * ECU-wide defaults for the RTI specific QoS settings of a DDSQoSProfile.
+ * They can be overridden by compiler flags or in the MCC_CONFIG_HEADER.
+ */
+#ifndef MCC_DDS_BATCHING
+#define MCC_DDS_BATCHING DDS_BOOLEAN_FALSE
+#endif
+#ifndef MCC_DDS_BATCH_MAX_SAMPLES
+#define MCC_DDS_BATCH_MAX_SAMPLES DDS_LENGTH_UNLIMITED
+#endif
+#ifndef MCC_DDS_BATCH_MAX_DATA_BYTES
+#define MCC_DDS_BATCH_MAX_DATA_BYTES 1024
+#endif
+#ifndef MCC_DDS_BATCH_FLUSH_DELAY_NS
+#define MCC_DDS_BATCH_FLUSH_DELAY_NS 0
+#endif
+#ifndef MCC_DDS_ASYNC_PUBLISH
+#define MCC_DDS_ASYNC_PUBLISH DDS_BOOLEAN_FALSE
+#endif
+#ifndef MCC_DDS_TRANSPORT
+#define MCC_DDS_TRANSPORT DDS_TRANSPORT_DEFAULT
+#endif
+#ifndef MCC_DDS_RECEIVE_THREAD_PRIORITY
+#define MCC_DDS_RECEIVE_THREAD_PRIORITY MCC_DDS_THREAD_PRIORITY_DEFAULT
+#endif
+#ifndef MCC_DDS_PUBLISH_POLICY
+#define MCC_DDS_PUBLISH_POLICY DDS_PUBLISH_ALWAYS
+#endif
+#ifndef MCC_DDS_DEADBAND
+#define MCC_DDS_DEADBAND 0.0
+#endif
+#ifndef MCC_DDS_MAX_SILENT_PERIOD_NS
+#define MCC_DDS_MAX_SILENT_PERIOD_NS 0
+#endif
+
+/*
+ * The outbound rings of MCC_DDS_ASYNC_SEND: the number of samples per port, a power of two, the maximum size
+ * of a sample, the maximum number of samples the sender thread writes from one ring before it flushes,
+ * and how long it sleeps while all rings are empty
+ */
+#ifndef MCC_DDS_ASYNC_RING_SIZE
+#define MCC_DDS_ASYNC_RING_SIZE 64
+#endif
+#ifndef MCC_DDS_ASYNC_SAMPLE_SIZE
+#define MCC_DDS_ASYNC_SAMPLE_SIZE 256
+#endif
+#ifndef MCC_DDS_ASYNC_BATCH
+#define MCC_DDS_ASYNC_BATCH 16
+#endif
+#ifndef MCC_DDS_ASYNC_IDLE_NS
+#define MCC_DDS_ASYNC_IDLE_NS 100000
+#endif
+
+/*
+ * The local routes of co-located DDS ports: the capacity of the MessageBuffer of a reading port per Topic
+ * and the maximum number of reading ports of a Topic on the ECU, at most 32
+ */
+#ifndef MCC_DDS_LOCAL_ROUTE_CAPACITY
+#define MCC_DDS_LOCAL_ROUTE_CAPACITY 16
+#endif
+#ifndef MCC_DDS_LOCAL_ROUTE_READERS
+#define MCC_DDS_LOCAL_ROUTE_READERS 8
+#endif
+
+/** Keeps the thread priority configured by RTI */
+#define MCC_DDS_THREAD_PRIORITY_DEFAULT (-9999999)
+
+/**
+ * @brief The builtin transports a DomainParticipant of a port may use
+ */
+typedef enum {
+	DDS_TRANSPORT_DEFAULT, DDS_TRANSPORT_SHMEM, DDS_TRANSPORT_UDPV4
+} DDSTransportKind;
+
+/**
+ * @brief When a continuous out-port publishes a value
+ */
+typedef enum {
+	DDS_PUBLISH_ALWAYS, /**< every value is written */
+	DDS_PUBLISH_ON_CHANGE, /**< a value is written if it differs from the last written value */
+	DDS_PUBLISH_DEADBAND_ABSOLUTE, /**< a value is written if it differs by more than the deadband */
+	DDS_PUBLISH_DEADBAND_RELATIVE /**< a value is written if it differs by more than deadband times the last written value */
+} DDSPublishPolicy;
+
+/**
+ * @brief QoS settings of a single PortInstanceConfiguration_DDS
+ * @details Holds the settings which are not part of the DDS entities in the model,
+ * they are applied on top of the QoS policies taken from the model
+ */
+typedef struct DDSQoSProfile {
+	DDS_Boolean batching; /**< collect samples of a writer into batches */
+	DDS_Long batchMaxSamples; /**< flush a batch after this number of samples */
+	DDS_Long batchMaxDataBytes; /**< flush a batch after this number of bytes */
+	DDS_UnsignedLong batchFlushDelayNs; /**< flush a batch at the latest after this delay, 0: no delay based flush */
+	DDS_Boolean asyncPublish; /**< send samples from the RTI asynchronous publisher thread */
+	DDSTransportKind transport; /**< builtin transport of the DomainParticipant */
+	DDS_Long receiveThreadPriority; /**< priority of the receive threads of the DomainParticipant */
+	DDSPublishPolicy publishPolicy; /**< when a continuous out-port writes a value */
+	double deadband; /**< the deadband of DDS_PUBLISH_DEADBAND_ABSOLUTE and DDS_PUBLISH_DEADBAND_RELATIVE */
+	uint64_T maxSilentPeriodNs; /**< a suppressed value is written anyway, if nothing was written for this period, 0: no limit */
+} DDSQoSProfile;
+
+/**
+ * @brief Initializer of a DDSQoSProfile using the ECU-wide defaults
+ */
+#define MCC_DDS_QOS_PROFILE_DEFAULT { MCC_DDS_BATCHING, MCC_DDS_BATCH_MAX_SAMPLES, \
+	MCC_DDS_BATCH_MAX_DATA_BYTES, MCC_DDS_BATCH_FLUSH_DELAY_NS, MCC_DDS_ASYNC_PUBLISH, \
+	MCC_DDS_TRANSPORT, MCC_DDS_RECEIVE_THREAD_PRIORITY, \
+	MCC_DDS_PUBLISH_POLICY, MCC_DDS_DEADBAND, MCC_DDS_MAX_SILENT_PERIOD_NS }
+
+/**
+ * @brief Whether a DDS sample and a MUML message have the same size, both are pointers to the structs
+ */
+#define MCC_DDS_SAME_SIZE(dds, muml) (sizeof(*(dds)) == sizeof(*(muml)))
+
+/**
+ * @brief Whether a field has the same offset and type in a DDS sample and a MUML message
+ * @details A compile time constant, so the copy not taken by the generated message transformation is removed
+ */
+#define MCC_DDS_SAME_FIELD(dds, muml, field) \
+	(offsetof(__typeof__(*(dds)), field) == offsetof(__typeof__(*(muml)), field) \
+	&& __builtin_types_compatible_p(__typeof__((dds)->field), __typeof__((muml)->field)))
+
+/**
+ * @brief With MCC_DDS_REQUIRE_SAME_LAYOUT a message transformation, which needs field copies, fails to compile
+ */
+#ifdef MCC_DDS_REQUIRE_SAME_LAYOUT
+#define MCC_DDS_CHECK_LAYOUT(sameLayout) _Static_assert(sameLayout, "the DDS type differs from the layout of the MUML message")
+#else
+#define MCC_DDS_CHECK_LAYOUT(sameLayout)
+#endif
+
+/**
+ * @brief Writes a sample with the typed write of its DataWriter, e.g. FooDataWriter_write
+ */
+typedef DDS_ReturnCode_t (*DDSAsyncWrite)(DDS_DataWriter* writer, const void* sample);
+
+/**
+ * @brief Defines the DDSAsyncWrite Type##_writeAsync of a DDS type, used by the containers of ECUs with MCC_DDS_ASYNC_SEND
+ */
+#define MCC_DDS_ASYNC_WRITE_FUNCTION(Type) \
+static DDS_ReturnCode_t Type##_writeAsync(DDS_DataWriter* writer, const void* sample) { \
+	return Type##DataWriter_write(Type##DataWriter_narrow(writer), (const Type*) sample, &DDS_HANDLE_NIL); \
+}
+
+/**
+ * @brief A sample waiting in a DDSOutboundRing and the DataWriter it is written with
+ */
+typedef struct DDSOutboundSample {
+	DDS_DataWriter* writer;
+	DDSAsyncWrite write; /**< the typed write of the DataWriter */
+	union {
+		unsigned char bytes[MCC_DDS_ASYNC_SAMPLE_SIZE];
+		long double alignment;
+		void* pointer;
+	} data;
+} DDSOutboundSample;
+
+/**
+ * @brief A single-producer single-consumer ring of the samples a port sends with MCC_DDS_ASYNC_SEND
+ * @details The thread of the component instances marshals a sample into a slot and publishes it by advancing tail,
+ * the sender thread writes it and advances head. Both indices run freely and are masked on access
+ */
+typedef struct DDSOutboundRing {
+	uint32_T head MCC_CACHE_ALIGNED; /**< the next sample to write, only advanced by the sender thread */
+	uint32_T tail MCC_CACHE_ALIGNED; /**< the next free slot, only advanced by the sending thread */
+	uint32_T dropped; /**< the number of samples dropped, because the ring was full */
+	uint32_T users; /**< the passes of the sender thread draining the ring right now, guarded by its lock */
+	struct DDSOutboundRing* next; /**< the next ring served by the sender thread */
+	DDSOutboundSample slots[MCC_DDS_ASYNC_RING_SIZE];
+} DDSOutboundRing;
+
+/**
+ * @brief The ports of an ECU using a Topic in the same domain and partition, see DDSHandle_routeLocally
+ */
+typedef struct DDSLocalRoute DDSLocalRoute;
+
+/**
+ * @brief The use of a DDSLocalRoute by a port, one per Topic the port writes or reads
+ */
+typedef struct DDSLocalEndpoint {
+	const char* topic; /**< the name of the Topic, owned by the DDSLocalRoute */
+	DDSLocalRoute* route;
+	DDS_DataWriter* writer; /**< the DataWriter of a writing port, NULL for a reading port */
+	DDS_DataReader* reader; /**< the DataReader of a reading port, NULL for a writing port */
+	DDS_InstanceHandle_t handle; /**< the instance handle of the DataReader of a reading port */
+	MessageFilter filter; /**< the messages a reading port accepts, NULL for all */
+	MessageBuffer* buffer; /**< the messages of the local writers for a reading port, created once the route has a writer */
+	struct DDS_InstanceHandleSeq matched; /**< the subscriptions of the DataWriter of a writing port, guarded by the route lock */
+	uint32_T updates; /**< the updates of matched by PublisherListener_PublicationMatched, guarded by the route lock */
+	uint32_T targets; /**< bit i is set, if a writing port sends to the reading port i of its route only, 0 for DDS */
+	uint32_T delivered; /**< the targets of the last send of a writing port, only used by the thread sending */
+	struct DDSLocalEndpoint* next; /**< the next writing port of the route */
+} DDSLocalEndpoint;
+
 //FIXME create DDSHandle;
 typedef struct DDSHandle {
 	DDS_DomainParticipant *participant;
 	DDS_Publisher *publisher;
 	DDS_Subscriber *subscriber;
-	u_int8_t numOfWriterToMatch;
-	u_int8_t numOfReaderToMatch;
+	u_int8_t numOfWriterToMatch; /**< updated atomically by the listener threads of RTI */
+	u_int8_t numOfReaderToMatch; /**< updated atomically by the listener threads of RTI */
+	DDS_Long partitionCount; /**< the number of partitions of the Publisher and Subscriber, cached when the handle is built */
+	const DDSQoSProfile* qos; /**< the DDSQoSProfile of the port, may be NULL */
+	bool_t published; /**< whether a value was written, see DDSHandle_markPublished */
+	double lastPublished; /**< the last value written by a continuous out-port */
+	uint64_T lastPublishTime; /**< the time of the last write of a continuous out-port in ns */
+	DDSOutboundRing* outbound; /**< the samples for the sender thread, NULL if the port writes synchronously */
+	uint8_T localCount; /**< the number of entries of local, one per Topic the port reads or writes */
+	DDSLocalEndpoint* local[]; /**< the local routes of the port by slot, NULL for a Topic using DDS only, see DDSHandle_routeLocally */
 } DDSHandle;
 
 
@@ -24,6 +230,187 @@ extern const DDSHandle INIT_DDSHandle;
 int publisher_shutdown(DDS_DomainParticipant *participant);
 int subscriber_shutdown(DDS_DomainParticipant *participant);
 
+/**
+ * Apply a DDSQoSProfile to the QoS of the DDS entities of a port, a NULL profile leaves the QoS untouched.
+ * Readers are configured by the QoS policies of the model only.
+ */
+void DDSQoSProfile_applyParticipant(const DDSQoSProfile* profile, struct DDS_DomainParticipantQos* qos);
+void DDSQoSProfile_applyWriter(const DDSQoSProfile* profile, struct DDS_DataWriterQos* qos);
+
+/**
+ * @brief Returns a DomainParticipant for a domain, which is shared by all ports of the ECU using the same domain and transport settings
+ * @details Thread safe, ports may be built concurrently: only ports of the same DomainParticipant wait while it is created.
+ * Every call has to be matched by DDSParticipant_release
+ *
+ * @param domainID the DDS domain
+ * @param qos the QoS used if a new DomainParticipant has to be created
+ * @param profile the DDSQoSProfile the qos was derived from, may be NULL
+ * @return the DomainParticipant, or NULL if it could not be created
+ */
+DDS_DomainParticipant* DDSParticipant_acquire(DDS_DomainId_t domainID, const struct DDS_DomainParticipantQos* qos, const DDSQoSProfile* profile);
+
+/**
+ * @brief Releases a DomainParticipant returned by DDSParticipant_acquire, the last release deletes it
+ */
+void DDSParticipant_release(DDS_DomainParticipant* participant);
+
+/**
+ * @brief Registers a data type and returns the Topic of a shared DomainParticipant, which is created on first use
+ * @details Thread safe. A Topic must only be created once per DomainParticipant, so ports sharing a DomainParticipant reuse it;
+ * only ports of the same Topic wait while it is created
+ *
+ * @return the Topic, or NULL if it could not be created
+ */
+DDS_Topic* DDSParticipant_getTopic(DDS_DomainParticipant* participant, const char* topicName, const char* typeName,
+		DDS_ReturnCode_t (*registerType)(DDS_DomainParticipant*, const char*));
+
+/**
+ * @brief Returns a ContentFilteredTopic of a shared DomainParticipant, which is created on first use
+ * @details Thread safe. The filter expression is evaluated by DDS, so samples the reader does not accept are not
+ * sent to it. Ports sharing a DomainParticipant and using the same name must use the same expression
+ *
+ * @param topic the related Topic, see DDSParticipant_getTopic
+ * @param name the name of the ContentFilteredTopic, unique per DomainParticipant
+ * @param expression the filter expression in the SQL subset of DDS
+ * @return the TopicDescription for the DataReader, or NULL if it could not be created
+ */
+DDS_TopicDescription* DDSParticipant_getFilteredTopic(DDS_DomainParticipant* participant, DDS_Topic* topic,
+		const char* name, const char* expression);
+
+/**
+ * @brief Deletes the Publisher and Subscriber of a DDSHandle including their DataWriters and DataReaders and releases its DomainParticipant
+ *
+ * @return 0 if all entities could be deleted, otherwise -1
+ */
+int DDSHandle_shutdown(DDSHandle* hndl);
+
+/**
+ * @brief Lets the sender thread write the samples of a port, the thread is started with the first port
+ * @details Used by the builders of ECUs compiled with MCC_DDS_ASYNC_SEND. DDSHandle_shutdown writes the
+ * remaining samples and removes the ring
+ *
+ * @return 0 on success, -1 if the ring or the thread could not be created
+ */
+int DDSHandle_enableAsyncSend(DDSHandle* hndl);
+
+/**
+ * @brief Reserves the next slot of the outbound ring of a port
+ * @details The caller marshals the sample into the slot and publishes it with DDSHandle_commitAsync.
+ * Costs a ring write, the sending thread never waits for RTI
+ *
+ * @param writer the DataWriter the sender thread writes the sample with
+ * @param write the typed write of the DataWriter, see MCC_DDS_ASYNC_WRITE_FUNCTION
+ * @return the memory of the sample, NULL if the ring is full or the port has no ring and the sample is dropped
+ */
+static inline void* DDSHandle_reserveAsync(DDSHandle* hndl, DDS_DataWriter* writer, DDSAsyncWrite write) {
+	DDSOutboundRing* ring = hndl->outbound;
+	DDSOutboundSample* slot;
+	if (ring == NULL) {
+		//DDSHandle_enableAsyncSend failed or the port was shut down
+		return NULL;
+	}
+	if (ring->tail - __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) == MCC_DDS_ASYNC_RING_SIZE) {
+		ring->dropped++;
+		return NULL;
+	}
+	slot = &ring->slots[ring->tail & (MCC_DDS_ASYNC_RING_SIZE - 1)];
+	slot->writer = writer;
+	slot->write = write;
+	return slot->data.bytes;
+}
+
+/**
+ * @brief Hands the sample of the slot reserved by DDSHandle_reserveAsync to the sender thread
+ */
+static inline void DDSHandle_commitAsync(DDSHandle* hndl) {
+	__atomic_store_n(&hndl->outbound->tail, hndl->outbound->tail + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Registers a Topic written or read by a port at the local route of the ECU
+ * @details Used by the builders, unless the ECU is compiled with MCC_DDS_NO_LOCAL_ROUTE. Ports of the ECU using the same
+ * domain, partition and Topic share a route: a message of a writing port is enqueued directly into a MessageBuffer of
+ * every reading port whose DataReader the DataWriter matched, as long as all subscriptions matched by the DataWriter
+ * are local ones. Otherwise it is written to DDS only and the reading ports take it from their DataReaders as before,
+ * so every message arrives exactly once. A writing port only switches from DDS to the route, once the DataReaders of
+ * the reading ports took the samples DDS delivered to them, and a reading port takes its MessageBuffer first, so the
+ * messages of a writer arrive in order. The DDS entities of the port are still created for the ports on other ECUs.
+ * A reading port gets a MessageBuffer of MCC_DDS_LOCAL_ROUTE_CAPACITY messages once the route has a writing port, so
+ * a Topic without a local writer costs no memory; MCC_FOOTPRINT_LOCAL_ROUTE_BYTES accounts for the others. At most
+ * MCC_DDS_LOCAL_ROUTE_READERS reading ports share a route, any further one uses DDS only.
+ * The subscriptions matched by a DataWriter are tracked by PublisherListener_PublicationMatched, which the Publisher
+ * of a writing port has to install. Thread safe, ports may be built concurrently. DDSHandle_shutdown removes the
+ * port from its routes
+ *
+ * @param slot the entry of DDSHandle::local for the Topic, assigned by the generator
+ * @param elementSize the size of the MUML message, a port with a different size is not routed locally
+ * @param writer the DataWriter of a writing port, NULL for a reading port
+ * @param reader the DataReader of a reading port, NULL for a writing port
+ * @param filter the messages a reading port accepts, NULL for all
+ * @return 0 on success, -1 if the port is not routed locally and uses DDS only
+ */
+int DDSHandle_routeLocally(DDSHandle* hndl, uint8_T slot, DDS_DomainId_t domainID, const char* partition,
+		const char* topic, size_t elementSize, DDS_DataWriter* writer, DDS_DataReader* reader, MessageFilter filter);
+
+/**
+ * @brief The DDSLocalEndpoint of a port for a slot, NULL if the port does not use a local route for its Topic
+ */
+static inline DDSLocalEndpoint* DDSHandle_getLocalEndpoint(DDSHandle* hndl, uint8_T slot) {
+	return hndl->local[slot];
+}
+
+/**
+ * @brief Delivers a message of a writing port to the reading ports of its local route
+ * @details Costs a MessageBuffer_enqueue per matched reading port, the matched reading ports are kept up to date by
+ * PublisherListener_PublicationMatched. While switching from DDS to the route, the cache status of their DataReaders
+ * is queried as well
+ *
+ * @param ep the DDSLocalEndpoint of the writing port, may be NULL
+ * @param msg the MUML message
+ * @return true if the message was delivered locally, false if it has to be written to DDS
+ */
+bool_t DDSLocalEndpoint_send(DDSLocalEndpoint* ep, const void* msg);
+
+/**
+ * @brief Dequeues the next message a local writer delivered to a reading port
+ *
+ * @param ep the DDSLocalEndpoint of the reading port, may be NULL
+ * @return true if a message was dequeued, false if the DataReader has to be asked
+ */
+static inline bool_t DDSLocalEndpoint_receive(DDSLocalEndpoint* ep, void* msg) {
+	MessageBuffer* buffer = ep != NULL ? __atomic_load_n(&ep->buffer, __ATOMIC_ACQUIRE) : NULL;
+	return buffer != NULL && MessageBuffer_dequeue(buffer, msg);
+}
+
+/**
+ * @brief Whether a local writer delivered a message to a reading port, which was not received yet
+ */
+static inline bool_t DDSLocalEndpoint_exists(DDSLocalEndpoint* ep) {
+	MessageBuffer* buffer = ep != NULL ? __atomic_load_n(&ep->buffer, __ATOMIC_ACQUIRE) : NULL;
+	return buffer != NULL && MessageBuffer_doesMessageExists(buffer);
+}
+
+/**
+ * @brief DDSHandle_shutdown and frees the DDSHandle
+ */
+void DDSHandle_destroy(DDSHandle* hndl);
+
+/**
+ * @brief Applies the publish policy of the DDSQoSProfile of a continuous out-port to a value
+ * @details Compares with the value of the last DDSHandle_markPublished. The first value is always written.
+ *
+ * @param hndl the DDSHandle of the port
+ * @param value the value the port is about to write
+ * @return true if the value shall be written, false if the policy suppresses it
+ */
+bool_t DDSHandle_shouldPublish(DDSHandle* hndl, double value);
+
+/**
+ * @brief Remembers the value and the time of a write of a continuous out-port for DDSHandle_shouldPublish
+ * @details Call it only once the value was written or handed to the sender thread, so a dropped value is sent again
+ */
+void DDSHandle_markPublished(DDSHandle* hndl, double value);
+
 
 
 /**
@@ -4,45 +4,161 @@
 extern "C" {
 #endif
 // Library
+#include <pthread.h>
+#include <stdint.h>
 #include "LocalBufferManager.h"
+#include "TraceRecorder.h"
+#include "ContainerProbes.h"
+#include "AsyncLog.h"
 
-const LocalHandle INIT_LocalHandle = { 0, 0,0};
+const LocalHandle INIT_LocalHandle = { 0, 0,0, 0, { 0, 0, 0 } };
 
 
-struct subscriber_node {
-	LocalSubscriber* subscriber;
-	struct subscriber_node *next;
-};
-
 struct buffer_hashed {
 	uint16_T id; /*key */
-	struct subscriber_node* subscriberList;
+	LocalSubscriberList* subscriberList;
 	UT_hash_handle hh; // make structure hashtable
 };
 
 static struct buffer_hashed *buffer_list = NULL; /* important! initialize to NULL */
+//guards buffer_list while component instances are built concurrently
+static pthread_mutex_t buffer_list_lock = PTHREAD_MUTEX_INITIALIZER;
+
+//true as soon as no more subscribers are registered concurrently
+static bool_t buffer_list_sealed = false;
+
+//true while a TraceReplay feeds the buffers instead of the component instances
+static bool_t publishing_muted = false;
 
-void publishMessage(uint16_T bufferID, uint16_T msgID, void* msg) {
+#ifdef MCC_FLOW_CONTROL
+static bool_t flow_control = true;
+#else
+static bool_t flow_control = false;
+#endif
+
+LocalSubscriberList* LocalBufferManager_lockSubscribers(uint16_T bufferID, uint16_T msgID, bool_t* locked) {
 	struct buffer_hashed *b;
 	uint16_T new_id = bufferID + msgID;
+	*locked = !__atomic_load_n(&buffer_list_sealed, __ATOMIC_ACQUIRE);
+	if (*locked) {
+		pthread_mutex_lock(&buffer_list_lock);
+	}
 	//find interested Subscriber
-	HASH_FIND_INT(buffer_list, &new_id, b);
-	if (b != NULL) {
-		struct subscriber_node *lst = b->subscriberList;
+	HASH_FIND(hh, buffer_list, &new_id, sizeof(uint16_T), b);
+	return b != NULL ? b->subscriberList : NULL;
+}
+
+void LocalBufferManager_unlockSubscribers(bool_t locked) {
+	if (locked) {
+		pthread_mutex_unlock(&buffer_list_lock);
+	}
+}
+
+DeliveryReport LocalBufferManager_deliver(uint16_T bufferID, uint16_T msgID, const void* msg) {
+	DeliveryReport report = { 0, 0, 0 };
+	bool_t locked;
+	LocalSubscriberList *lst = LocalBufferManager_lockSubscribers(bufferID, msgID, &locked);
+	//the size of a message is only known by its subscribers
+	MCC_TRACE_EVENT(TRACE_PUBLISH, NULL, bufferID, msgID, msg,
+			lst != NULL ? lst->subscriber->buffer->elementSize : 0);
+	if (LocalBufferManager_admit(lst, msg, &report)) {
 		while (lst != NULL) {
-			MessageBuffer_enqueue(lst->subscriber->buffer, msg);
+			if (LocalSubscriber_accepts(lst->subscriber, msg)) {
+				DeliveryReport_record(&report, MessageBuffer_enqueue(lst->subscriber->buffer, msg));
+			}
 			lst = lst->next;
 		}
 	}
+	LocalBufferManager_unlockSubscribers(locked);
+	return report;
+}
+
+DeliveryReport publishMessage(uint16_T bufferID, uint16_T msgID, void* msg) {
+	DeliveryReport report = { 0, 0, 0 };
+	MCC_PROBE3(publish_entry, bufferID, msgID, msg);
+	if (!publishing_muted) {
+		report = LocalBufferManager_deliver(bufferID, msgID, msg);
+	}
+	MCC_PROBE4(publish_return, bufferID, msgID, report.delivered, report.droppedMask);
+	return report;
+}
+
+bool_t LocalBufferManager_admit(LocalSubscriberList* lst, const void* msg, DeliveryReport* report) {
+	LocalSubscriberList *sub;
+	MessageBuffer *buf;
+	if (!flow_control) {
+		return true;
+	}
+	for (sub = lst; sub != NULL; sub = sub->next) {
+		buf = sub->subscriber->buffer;
+		if (buf->count == buf->capacity && (buf->keySize == 0 || MessageBuffer_findPending(buf, msg) == NULL)
+				&& LocalSubscriber_accepts(sub->subscriber, msg)) {
+			//the slowest subscriber has no credit left: refuse the message for all subscribers
+			for (sub = lst; sub != NULL; sub = sub->next) {
+				if (LocalSubscriber_accepts(sub->subscriber, msg)) {
+					DeliveryReport_record(report, false);
+				}
+			}
+			return false;
+		}
+	}
+	return true;
+}
+
+void LocalBufferManager_setFlowControl(bool_t enabled) {
+	flow_control = enabled;
+}
+
+size_t LocalBufferManager_getCredits(uint16_T bufferID, uint16_T msgID) {
+	size_t credits = SIZE_MAX;
+	size_t free_slots;
+	bool_t locked;
+	LocalSubscriberList *lst = LocalBufferManager_lockSubscribers(bufferID, msgID, &locked);
+	while (lst != NULL) {
+		free_slots = lst->subscriber->buffer->capacity - lst->subscriber->buffer->count;
+		if (free_slots < credits) {
+			credits = free_slots;
+		}
+		lst = lst->next;
+	}
+	LocalBufferManager_unlockSubscribers(locked);
+	return credits;
+}
+
+size_t LocalHandle_getCredits(const Port* port, uint16_T msgID) {
+	if (port->handle == NULL || port->handle->type != PORT_HANDLE_TYPE_LOCAL) {
+		return SIZE_MAX;
+	}
+	return LocalBufferManager_getCredits(((LocalHandle*) port->handle->concreteHandle)->pubID, msgID);
+}
+
+DeliveryReport LocalHandle_getLastDelivery(const Port* port) {
+	DeliveryReport none = { 0, 0, 0 };
+	if (port->handle == NULL || port->handle->type != PORT_HANDLE_TYPE_LOCAL) {
+		return none;
+	}
+	return ((LocalHandle*) port->handle->concreteHandle)->lastDelivery;
+}
+
+void LocalBufferManager_setMuted(bool_t muted) {
+	publishing_muted = muted;
+}
+
+bool_t LocalBufferManager_isMuted(void) {
+	return publishing_muted;
+}
+
+void LocalBufferManager_seal(void) {
+	__atomic_store_n(&buffer_list_sealed, true, __ATOMIC_RELEASE);
 }
 
-static void appendSubscriber(struct subscriber_node **lst,
+static void appendSubscriber(LocalSubscriberList **lst,
 		LocalSubscriber* value) {
-	struct subscriber_node *new_node;
+	LocalSubscriberList *new_node;
 	while (*lst != NULL) {
 		lst = &(*lst)->next;
 	}
-	new_node = malloc(sizeof(struct subscriber_node));
+	new_node = malloc(sizeof(LocalSubscriberList));
 	new_node->subscriber = value;
 	new_node->next = NULL;
 	*lst = new_node;
@@ -52,23 +168,96 @@ static void registerSubscriber(LocalSubscriber* sub, uint16_T bufferID,
 		uint16_T msgID) {
 	struct buffer_hashed *b;
 	uint16_T new_id = bufferID + msgID;
-	HASH_FIND_INT(buffer_list, &new_id, b); /* id already in the hash? */
+	pthread_mutex_lock(&buffer_list_lock);
+	HASH_FIND(hh, buffer_list, &new_id, sizeof(uint16_T), b); /* id already in the hash? */
 	if (b == NULL) {
 		b = (struct buffer_hashed*) malloc(sizeof(struct buffer_hashed));
 		b->id = new_id;
 		b->subscriberList = NULL;
 		appendSubscriber(&(b->subscriberList), sub);
-		HASH_ADD_INT(buffer_list, id, b); /* id: name of key field */
+		HASH_ADD(hh, buffer_list, id, sizeof(uint16_T), b); /* id: name of key field */
 	}
 	else{
-		appendSubscriber(&(buffer_list->subscriberList), sub);
+		appendSubscriber(&(b->subscriberList), sub);
 	}
+	pthread_mutex_unlock(&buffer_list_lock);
+}
+
+static void unregisterSubscriber(LocalSubscriber* sub, uint16_T bufferID,
+		uint16_T msgID) {
+	struct buffer_hashed *b;
+	LocalSubscriberList **lst;
+	LocalSubscriberList *node;
+	uint16_T new_id = bufferID + msgID;
+	pthread_mutex_lock(&buffer_list_lock);
+	HASH_FIND(hh, buffer_list, &new_id, sizeof(uint16_T), b);
+	if (b != NULL) {
+		for (lst = &(b->subscriberList); *lst != NULL; lst = &(*lst)->next) {
+			if ((*lst)->subscriber == sub) {
+				node = *lst;
+				*lst = node->next;
+				free(node);
+				break;
+			}
+		}
+		//publishers expect a subscriber in every list they find
+		if (b->subscriberList == NULL) {
+			HASH_DEL(buffer_list, b);
+			free(b);
+		}
+	}
+	pthread_mutex_unlock(&buffer_list_lock);
+}
+
+void LocalSubscriber_setFilter(LocalSubscriber* subscriber, MessageFilter filter) {
+	//publishers read the filter under buffer_list_lock until the subscriber lists are sealed
+	pthread_mutex_lock(&buffer_list_lock);
+	subscriber->filter = filter;
+	pthread_mutex_unlock(&buffer_list_lock);
+}
+
+void unsubscribeFromMessage(LocalSubscriber* subscriber, uint16_T bufferID, uint16_T msgID) {
+	unregisterSubscriber(subscriber, bufferID, msgID);
+	MessageBuffer_destroy(subscriber->buffer);
+	subscriber->buffer = NULL;
+}
+
+void LocalHandle_destroy(LocalHandle* hndl) {
+	uint8_T i;
+	if (hndl == NULL) {
+		return;
+	}
+	for (i = 0; i < hndl->numOfSubs; i++) {
+		unsubscribeFromMessage(&(hndl->localSubscribers[i]), hndl->subID, hndl->localSubscribers[i].msgID);
+	}
+	free(hndl);
 }
 
 void subscribeToMessage( LocalSubscriber* subscriber, uint16_T bufferID, uint16_T msgID,
 		size_t capactiy, size_t elementSize, bool_t mode) {
 	subscriber->buffer = MessageBuffer_create(capactiy, elementSize, mode);
 	subscriber->msgID=msgID;
+	subscriber->filter = NULL;
+	if (subscriber->buffer == NULL) {
+		//publishers enqueue into the MessageBuffer of every registered subscriber
+		MCC_LOG("MessageBuffer of message %u of buffer %u could not be created, the messages are dropped\n",
+				(unsigned) msgID, (unsigned) bufferID);
+		return;
+	}
+	registerSubscriber(subscriber, bufferID, msgID);
+}
+
+void subscribeToMessageConflating(LocalSubscriber* subscriber, uint16_T bufferID, uint16_T msgID, size_t capacity,
+		size_t elementSize, bool_t mode, size_t keyOffset, size_t keySize) {
+	subscriber->buffer = MessageBuffer_create(capacity, elementSize, mode);
+	subscriber->msgID = msgID;
+	subscriber->filter = NULL;
+	if (subscriber->buffer == NULL) {
+		MCC_LOG("MessageBuffer of message %u of buffer %u could not be created, the messages are dropped\n",
+				(unsigned) msgID, (unsigned) bufferID);
+		return;
+	}
+	MessageBuffer_setConflationKey(subscriber->buffer, keyOffset, keySize);
 	registerSubscriber(subscriber, bufferID, msgID);
 }
 
@@ -15,23 +15,161 @@ extern "C" {
 typedef struct LocalSubscriber {
 	uint16_T msgID;
 	MessageBuffer* buffer;
+	MessageFilter filter; /**< the messages the subscriber accepts, NULL for all */
 } LocalSubscriber;
 
+/**
+ * @brief The result of a publish for every subscriber
+ * @details Subscribers are counted in the order they subscribed; droppedMask only covers the first 32 subscribers
+ */
+typedef struct DeliveryReport {
+	uint8_T subscribers; /**< the number of subscribers of the message */
+	uint8_T delivered; /**< the number of subscribers, which enqueued the message */
+	uint32_T droppedMask; /**< bit i is set, if subscriber i dropped the message, because its buffer was full */
+} DeliveryReport;
+
 //FIXME create localHandle
 typedef struct LocalHandle {
 	uint16_T pubID; //under which ID I want to publish (aka my own)
 	uint16_T subID; // to which one, do I want to listen
 	uint8_T numOfSubs;
+	uint32_T pendingMask; //bit p is set, while the MessageBuffer of the message type with priority p is not empty
+	DeliveryReport lastDelivery; //result of the last message sent via this handle
 	LocalSubscriber localSubscribers[];
 //LocalPublisher* localPublishers;
 //	uint8_T numofPubs;
 } LocalHandle;
 
 
+/**
+ * @brief The subscribers of a bufferID and msgID
+ */
+typedef struct LocalSubscriberList {
+	LocalSubscriber* subscriber;
+	struct LocalSubscriberList *next;
+} LocalSubscriberList;
+
 extern const LocalHandle INIT_LocalHandle;
 
 void subscribeToMessage( LocalSubscriber* subscriber, uint16_T bufferID, uint16_T msgID, size_t capactiy, size_t elementSize, bool_t mode);
-void publishMessage(uint16_T bufferID, uint16_T msgID,void* msg);
+
+/**
+ * @brief Like subscribeToMessage, but the MessageBuffer keeps only the latest pending message per key
+ * @details See MessageBuffer_setConflationKey, the key is set before the subscriber becomes visible to publishers.
+ * Like subscribeToMessage, a subscriber whose MessageBuffer could not be allocated keeps a NULL buffer and is not registered
+ */
+void subscribeToMessageConflating(LocalSubscriber* subscriber, uint16_T bufferID, uint16_T msgID, size_t capacity,
+		size_t elementSize, bool_t mode, size_t keyOffset, size_t keySize);
+DeliveryReport publishMessage(uint16_T bufferID, uint16_T msgID,void* msg);
+
+/**
+ * @brief Lets a subscriber accept only the messages its filter is true for
+ * @details Rejected messages are neither enqueued nor counted in the DeliveryReport, so they never take a slot
+ * of its MessageBuffer and do not count against the flow control. Call it after subscribeToMessage
+ */
+void LocalSubscriber_setFilter(LocalSubscriber* subscriber, MessageFilter filter);
+
+/**
+ * @brief Whether the filter of a subscriber accepts a message
+ */
+static inline bool_t LocalSubscriber_accepts(const LocalSubscriber* subscriber, const void* msg) {
+	return subscriber->filter == NULL || subscriber->filter(msg);
+}
+
+/**
+ * @brief Removes a subscriber registered by subscribeToMessage and destroys its MessageBuffer
+ * @details Publishers do not lock the subscriber lists after LocalBufferManager_seal, so call it from the thread
+ * that executes the component instances
+ */
+void unsubscribeFromMessage(LocalSubscriber* subscriber, uint16_T bufferID, uint16_T msgID);
+
+/**
+ * @brief Unsubscribes all LocalSubscriber%s of a LocalHandle and frees the LocalHandle
+ */
+void LocalHandle_destroy(LocalHandle* hndl);
+
+/**
+ * @brief Adds the result of one subscriber to a DeliveryReport
+ */
+static inline void DeliveryReport_record(DeliveryReport* report, bool_t enqueued) {
+	if (enqueued) {
+		report->delivered++;
+	} else if (report->subscribers < 32) {
+		report->droppedMask |= (uint32_T) 1 << report->subscribers;
+	}
+	report->subscribers++;
+}
+
+/**
+ * @brief Switches the credit-based flow control on or off, it is on by default, if compiled with MCC_FLOW_CONTROL
+ * @details With flow control, a message is only enqueued if every subscriber has a free slot. Otherwise it is
+ * refused for all subscribers, even for those in overwrite mode, and the DeliveryReport shows it as dropped.
+ */
+void LocalBufferManager_setFlowControl(bool_t enabled);
+
+/**
+ * @brief Whether the message msg may be enqueued to the subscribers lst under the flow control
+ * @details If not, every subscriber accepting the message is recorded as dropped in report. A full conflating
+ * subscriber still admits a message that replaces a pending message with the same key.
+ */
+bool_t LocalBufferManager_admit(LocalSubscriberList* lst, const void* msg, DeliveryReport* report);
+
+/**
+ * @brief The free capacity of the slowest subscriber of bufferID and msgID
+ * @details A publisher can throttle or batch, while this is 0, instead of producing messages that will be dropped
+ * @return the smallest number of free slots of all subscribers, SIZE_MAX if there is no subscriber
+ */
+size_t LocalBufferManager_getCredits(uint16_T bufferID, uint16_T msgID);
+
+/**
+ * @brief LocalBufferManager_getCredits for the messages sent via a port
+ * @return the credits, SIZE_MAX if the port does not use a LocalHandle
+ */
+size_t LocalHandle_getCredits(const Port* port, uint16_T msgID);
+
+/**
+ * @brief The DeliveryReport of the last message sent via a port
+ * @details The generated send methods return void, so they store the report in the LocalHandle of the port.
+ * Ports without LocalHandle report no subscribers.
+ */
+DeliveryReport LocalHandle_getLastDelivery(const Port* port);
+
+/**
+ * @brief Marks the end of the initialization phase
+ * @details Until then, subscribers may be registered concurrently and publishMessage has to lock the subscriber lists
+ */
+void LocalBufferManager_seal(void);
+
+/**
+ * @brief Enqueues a message into the MessageBuffers of all subscribers of bufferID and msgID
+ * @details Same as publishMessage, but not affected by LocalBufferManager_setMuted
+ */
+DeliveryReport LocalBufferManager_deliver(uint16_T bufferID, uint16_T msgID, const void* msg);
+
+/**
+ * @brief Looks up the subscribers of bufferID and msgID for a publish
+ * @details Locks the subscriber lists, if the initialization phase is not over yet.
+ * Every call has to be followed by LocalBufferManager_unlockSubscribers
+ *
+ * @param locked set to whether the lists have been locked
+ * @return the subscribers or NULL
+ */
+LocalSubscriberList* LocalBufferManager_lockSubscribers(uint16_T bufferID, uint16_T msgID, bool_t* locked);
+
+/**
+ * @brief Releases the subscriber lists after LocalBufferManager_lockSubscribers
+ */
+void LocalBufferManager_unlockSubscribers(bool_t locked);
+
+/**
+ * @brief Whether publishMessage currently drops the messages
+ */
+bool_t LocalBufferManager_isMuted(void);
+
+/**
+ * @brief Drops the messages published by the component instances, e.g. while a TraceReplay provides their messages
+ */
+void LocalBufferManager_setMuted(bool_t muted);
 
 #ifdef __cplusplus
 }
@@ -6,20 +6,35 @@
  */
 
 #include "MessageBuffer.h"
+#include "TraceRecorder.h"
+#include "ContainerProbes.h"
+
+//bytes currently allocated by all MessageBuffers, compared against ECU_Footprint.h
+static size_t allocated_bytes = 0;
 
 MessageBuffer* MessageBuffer_create(size_t capacity, size_t elementSize,
 		bool_t mode) {
-	MessageBuffer* buf = (MessageBuffer*) malloc(sizeof(MessageBuffer));
+	//the MessageBuffer gets cache lines of its own, so head and tail of buffers of different consumers do not share one
+	MessageBuffer* buf = (MessageBuffer*) Placement_allocCacheAligned(sizeof(MessageBuffer));
 	if (buf != NULL) {
 		buf->elementSize = elementSize;
 		buf->capacity = capacity;
 		buf->bufferMode = mode;
-		buf->buffer = malloc(capacity * elementSize);
+		buf->buffer = Placement_allocCacheAligned(capacity * elementSize);
+		if (buf->buffer == NULL) {
+			free(buf);
+			return NULL;
+		}
 		buf->buffer_end = (char *) buf->buffer + buf->capacity * buf->elementSize;
 		//initialize the new created MessageBuffer
 		buf->head = buf->buffer;
 		buf->tail = buf->buffer;
 		buf->count = 0;
+		buf->keyOffset = 0;
+		buf->keySize = 0;
+		buf->pendingMask = NULL;
+		buf->pendingBit = 0;
+		__atomic_add_fetch(&allocated_bytes, MESSAGEBUFFER_FOOTPRINT(capacity, elementSize), __ATOMIC_RELAXED);
 	}
 	return buf;
 }
@@ -28,25 +43,73 @@ size_t MessageBuffer_getSize(MessageBuffer* buf) {
 	return buf->count;
 }
 
+void MessageBuffer_setConflationKey(MessageBuffer* buf, size_t keyOffset, size_t keySize) {
+	buf->keyOffset = keyOffset;
+	buf->keySize = keySize;
+}
+
+void MessageBuffer_setPendingMask(MessageBuffer* buf, uint32_T* mask, uint8_T bit) {
+	buf->pendingMask = mask;
+	buf->pendingBit = (uint32_T) 1 << bit;
+	if (buf->count > 0) {
+		*mask |= buf->pendingBit;
+	}
+}
+
+void* MessageBuffer_findPending(MessageBuffer* buf, const void* msg) {
+	char* slot = (char*) buf->head;
+	size_t i;
+	for (i = 0; i < buf->count; i++) {
+		if (memcmp(slot + buf->keyOffset, (const char*) msg + buf->keyOffset, buf->keySize) == 0) {
+			return slot;
+		}
+		slot += buf->elementSize;
+		if (slot == buf->buffer_end) {
+			slot = (char*) buf->buffer;
+		}
+	}
+	return NULL;
+}
+
 bool_t MessageBuffer_enqueue(MessageBuffer* buf, const void* msg) {
+	void* pending;
+	if (buf->keySize != 0 && (pending = MessageBuffer_findPending(buf, msg)) != NULL) {
+		//conflation: the newer message replaces the pending one with the same key and keeps its position
+		MCC_TRACE_EVENT(TRACE_ENQUEUE, buf, 0, 0, msg, buf->elementSize);
+		MCC_PROBE2(enqueue_conflate, buf, pending);
+		memcpy(pending, msg, buf->elementSize);
+		return true;
+	}
 	if (buf->count < buf->capacity) {
 		//the buffer is still not full
+		MCC_TRACE_EVENT(TRACE_ENQUEUE, buf, 0, 0, msg, buf->elementSize);
+		MCC_PROBE3(enqueue, buf, buf->tail, buf->count + 1);
 		memcpy(buf->tail,msg,  buf->elementSize);
 		buf->tail = (char *) buf->tail + buf->elementSize;
 		buf->count++;
 		if (buf->tail == buf->buffer_end) {
 			buf->tail = buf->buffer;
 		}
+		if (buf->pendingMask != NULL) {
+			*buf->pendingMask |= buf->pendingBit;
+		}
 		return true;
 	} else if (buf->bufferMode) { //replace oldest message in buffer
-		//tail points to start again (see above)
+		MCC_TRACE_EVENT(TRACE_ENQUEUE, buf, 0, 0, msg, buf->elementSize);
+		MCC_PROBE2(enqueue_overwrite, buf, buf->tail);
+		//the buffer is full, so tail points to the oldest message (head)
 		memcpy(buf->tail, msg ,buf->elementSize);
 		buf->tail = (char *) buf->tail + buf->elementSize;
-		buf->head = (char *) buf->head + buf->elementSize;
+		if (buf->tail == buf->buffer_end) {
+			buf->tail = buf->buffer;
+		}
+		buf->head = buf->tail;
 
 		return true;
 	}
 
+	MCC_TRACE_EVENT(TRACE_DROP, buf, 0, 0, msg, buf->elementSize);
+	MCC_PROBE2(enqueue_drop, buf, msg);
 	return false;
 
 }
@@ -54,17 +117,51 @@ bool_t MessageBuffer_enqueue(MessageBuffer* buf, const void* msg) {
 bool_t MessageBuffer_dequeue(MessageBuffer* buf, void* msg) {
 	if (buf->count > 0) {
 		memcpy(msg, buf->head, buf->elementSize);
+		MCC_TRACE_EVENT(TRACE_DEQUEUE, buf, 0, 0, msg, buf->elementSize);
+		MCC_PROBE3(dequeue, buf, buf->head, buf->count - 1);
 		buf->head = (char *) buf->head + buf->elementSize;
 		buf->count--;
 		if (buf->head == buf->buffer_end) {
 			buf->head = buf->buffer;
 		}
+		if (buf->count == 0 && buf->pendingMask != NULL) {
+			*buf->pendingMask &= ~buf->pendingBit;
+		}
 	return true;
 	}
 
 	return false;
 }
 
+size_t MessageBuffer_dequeueBulk(MessageBuffer* buf, void* msgs, size_t max) {
+	size_t n = buf->count < max ? buf->count : max;
+	size_t first;
+	size_t i;
+	char* head;
+	if (n == 0) {
+		return 0;
+	}
+	//the span up to the end of the ring, then the rest from its start
+	first = ((char*) buf->buffer_end - (char*) buf->head) / buf->elementSize;
+	if (first > n) {
+		first = n;
+	}
+	memcpy(msgs, buf->head, first * buf->elementSize);
+	memcpy((char*) msgs + first * buf->elementSize, buf->buffer, (n - first) * buf->elementSize);
+	for (i = 0; i < n; i++) {
+		MCC_TRACE_EVENT(TRACE_DEQUEUE, buf, 0, 0, (char*) msgs + i * buf->elementSize, buf->elementSize);
+		MCC_PROBE3(dequeue, buf, i < first ? (char*) buf->head + i * buf->elementSize
+				: (char*) buf->buffer + (i - first) * buf->elementSize, buf->count - i - 1);
+	}
+	head = (char*) buf->head + first * buf->elementSize;
+	buf->head = (head == buf->buffer_end) ? (char*) buf->buffer + (n - first) * buf->elementSize : head;
+	buf->count -= n;
+	if (buf->count == 0 && buf->pendingMask != NULL) {
+		*buf->pendingMask &= ~buf->pendingBit;
+	}
+	return n;
+}
+
 bool_t MessageBuffer_doesMessageExists(MessageBuffer* buf) {
 
 	return buf->count > 0;
@@ -72,9 +169,14 @@ bool_t MessageBuffer_doesMessageExists(MessageBuffer* buf) {
 
 void MessageBuffer_destroy(MessageBuffer* buf) {
 	if (buf != NULL) {
+		__atomic_sub_fetch(&allocated_bytes, MESSAGEBUFFER_FOOTPRINT(buf->capacity, buf->elementSize), __ATOMIC_RELAXED);
 		//free the memory of the messages which are contained in this buffer
 		free(buf->buffer);
 		//free the memory of the MessageBuffer
 		free(buf);
 	}
 }
+
+size_t MessageBuffer_getAllocatedBytes(void) {
+	return __atomic_load_n(&allocated_bytes, __ATOMIC_RELAXED);
+}
@@ -9,6 +9,7 @@
 
 //FIXME: moved from Lib Folder here (components shall not have a dependency to a buffer)
 
+#include <stddef.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -16,6 +17,7 @@
 
 
 #include "standardTypes.h"
+#include "Placement.h"
 /**
  * 
  * @brief A MessageBuffer of a Port
@@ -31,12 +33,23 @@ typedef struct MessageBuffer{
 	void* head;  /**< The current Index of the MessageBuffer::queue */ // points to the current head element
 	void* tail;  /**< The current Tail of the MessageBuffer::queue */ // points to the next free slot
 	bool_t bufferMode;  /**< The mode of a MessageBuffer - false: discard new incoming message; true: replace oldest message*/
+	size_t keyOffset; /**< The offset of the key field in a message, see MessageBuffer_setConflationKey */
+	size_t keySize; /**< The size of the key field, 0 if the MessageBuffer is a plain FIFO */
+	uint32_T* pendingMask; /**< The bitmap of non-empty MessageBuffers of a port, see MessageBuffer_setPendingMask */
+	uint32_T pendingBit; /**< The bit of this MessageBuffer in MessageBuffer::pendingMask */
 }MessageBuffer;
 
+/**
+ * @brief The bytes allocated for a MessageBuffer, the MessageBuffer and its queue occupy full cache lines
+ */
+#define MESSAGEBUFFER_FOOTPRINT(capacity, elementSize) \
+	(MCC_CACHE_ROUND(sizeof(MessageBuffer)) + MCC_CACHE_ROUND((capacity) * (elementSize)))
+
 
  /**
   * @brief Creates a new MessageBuffer
-  * @details Memory for a MessageBuffer and its queue is allocated and the MessageBuffer is initialized
+  * @details Memory for a MessageBuffer and its queue is allocated and the MessageBuffer is initialized.
+  * Both are aligned to cache lines and touched by the calling thread, so call it on the core of the consumer
   * 
   * @param size the size of the queue for this MessageBuffer
   * @param mode description
@@ -81,6 +94,51 @@ bool_t MessageBuffer_enqueue(MessageBuffer* buf, const void* msg);
   */
 bool_t MessageBuffer_dequeue(MessageBuffer* buf, void* msg);
 
+ /**
+  * @brief Dequeues up to max MiddlewareMessages in their order
+  * @details The pending messages occupy at most two contiguous spans of the ring, so they are copied with at most two memcpys
+  *
+  * @param buf The MessageBuffer
+  * @param msgs An array of at least max messages
+  * @param max The maximum number of messages to dequeue
+  *
+  * @return the number of dequeued messages
+  */
+size_t MessageBuffer_dequeueBulk(MessageBuffer* buf, void* msgs, size_t max);
+
+
+/**
+ * @brief Makes a MessageBuffer conflating: it keeps only the latest pending message per key
+ * @details A message whose key field equals the key of a pending message replaces that message in place,
+ * so it keeps the queue position of the replaced message and the MessageBuffer does not grow.
+ * Messages with a new key are enqueued according to MessageBuffer::bufferMode. Set the key before the first enqueue.
+ *
+ * @param buf The MessageBuffer
+ * @param keyOffset the offset of the key field, e.g. offsetof(Message, targetID)
+ * @param keySize the size of the key field, 0 turns conflation off
+ */
+void MessageBuffer_setConflationKey(MessageBuffer* buf, size_t keyOffset, size_t keySize);
+
+/**
+ * @brief Lets a MessageBuffer maintain a bit in a bitmap of the non-empty MessageBuffers of its port
+ * @details The bit is set, when a message is enqueued, and cleared, when the last message is dequeued.
+ * The receiver finds the most urgent non-empty MessageBuffer of a port with a single find-first-set.
+ *
+ * @param buf The MessageBuffer
+ * @param mask the bitmap, usually LocalHandle::pendingMask
+ * @param bit the index of the bit of buf, lower bits are more urgent
+ */
+void MessageBuffer_setPendingMask(MessageBuffer* buf, uint32_T* mask, uint8_T bit);
+
+/**
+ * @brief The pending message with the same key as msg
+ * @details Only for conflating MessageBuffer%s, the pending messages are compared bytewise on the key field
+ *
+ * @param buf The MessageBuffer
+ * @param msg The message whose key is looked up
+ * @return the slot of the pending message in the queue, NULL if no message with this key is pending
+ */
+void* MessageBuffer_findPending(MessageBuffer* buf, const void* msg);
 
 /**
  * @brief Whether a MessageBuffer contains a MiddlewareMessage with a specific MessageID
@@ -103,4 +161,14 @@ bool_t MessageBuffer_doesMessageExists(MessageBuffer* buf);
   */
 void MessageBuffer_destroy(MessageBuffer* buf);
 
+ /**
+  * @brief The memory currently held by all MessageBuffer%s
+  * @details Counts the MessageBuffer itself and its queue, i.e. MESSAGEBUFFER_FOOTPRINT(capacity, elementSize)
+  * for every MessageBuffer that was created and not yet destroyed. Compare with MCC_FOOTPRINT_MESSAGEBUFFER_BYTES
+  * of the generated ECU_Footprint.h
+  *
+  * @return the number of allocated bytes
+  */
+size_t MessageBuffer_getAllocatedBytes(void);
+
 #endif /* MESSAGEBUFFER_H_ */
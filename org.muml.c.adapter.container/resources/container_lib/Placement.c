@@ -0,0 +1,54 @@
+/*
+ * Placement.c
+ */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include "Placement.h"
+#include "AsyncLog.h"
+
+void* Placement_allocCacheAligned(size_t size) {
+	void* mem = NULL;
+	size_t rounded = MCC_CACHE_ROUND(size);
+	if (posix_memalign(&mem, MCC_CACHE_LINE_SIZE, rounded) != 0) {
+		return NULL;
+	}
+	//first touch: the pages are placed on the NUMA node of the calling thread
+	memset(mem, 0, rounded);
+	return mem;
+}
+
+int Placement_readAffinity(int cpu) {
+	const char* value = getenv(MCC_AFFINITY_ENV);
+	char* end;
+	long parsed;
+
+	if (value == NULL) {
+		return cpu;
+	}
+	parsed = strtol(value, &end, 10);
+	if (end == value) {
+		return cpu;
+	}
+	return (int) parsed;
+}
+
+int Placement_pinCurrentThread(int cpu) {
+	cpu_set_t set;
+
+	if (cpu < 0) {
+		return 0;
+	}
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &set) != 0) {
+		MCC_LOG("Placement: cannot pin thread to cpu %d\n", cpu);
+		return -1;
+	}
+	return 0;
+}
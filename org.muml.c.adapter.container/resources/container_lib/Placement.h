@@ -0,0 +1,62 @@
+/**
+ * @file
+ * @brief Placement of component instances and their MessageBuffer%s on the cores of an ECU
+ * @details Component instances are pinned to a core while they are built. Linux places a page on the
+ * NUMA node of the core that touches it first, so the MessageBuffer%s of an instance end up on the node of
+ * the core that consumes them. All component instances of an ECU are executed by its main thread, so they are
+ * built on the core of the main thread; -1 leaves the threads unpinned.
+ */
+#ifndef PLACEMENT_H_
+#define PLACEMENT_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+#ifndef MCC_CACHE_LINE_SIZE
+#define MCC_CACHE_LINE_SIZE 64 /**< the size of a cache line of the target */
+#endif
+
+/**
+ * @brief Aligns a variable or a struct member to a cache line, a struct type with this attribute is padded to full lines
+ */
+#define MCC_CACHE_ALIGNED __attribute__((aligned(MCC_CACHE_LINE_SIZE)))
+
+/**
+ * @brief Rounds a size up to full cache lines
+ */
+#define MCC_CACHE_ROUND(size) ((((size) + MCC_CACHE_LINE_SIZE - 1) / MCC_CACHE_LINE_SIZE) * MCC_CACHE_LINE_SIZE)
+
+#ifndef MCC_AFFINITY_ENV
+#define MCC_AFFINITY_ENV "MCC_AFFINITY" /**< environment variable overriding the core of the main thread, e.g. MCC_AFFINITY=2 */
+#endif
+
+/**
+ * @brief Allocates memory that starts at a cache line and occupies full cache lines
+ * @details The memory is zeroed, so its pages are touched by the calling thread. Release it with free().
+ * @return the memory or NULL
+ */
+void* Placement_allocCacheAligned(size_t size);
+
+/**
+ * @brief Overrides a core with the value of MCC_AFFINITY_ENV
+ *
+ * @param cpu the core to use if MCC_AFFINITY_ENV is not set or not a number
+ * @return the core of MCC_AFFINITY_ENV or cpu
+ */
+int Placement_readAffinity(int cpu);
+
+/**
+ * @brief Pins the calling thread to a core
+ *
+ * @param cpu the core, -1 does nothing
+ * @return 0 on success, otherwise -1
+ */
+int Placement_pinCurrentThread(int cpu);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* PLACEMENT_H_ */
@@ -0,0 +1,11 @@
+#include "SimulationClock.h"
+
+static uint64_T virtual_now = 0;
+
+uint64_T SimulationClock_now(void) {
+	return __atomic_load_n(&virtual_now, __ATOMIC_RELAXED);
+}
+
+void SimulationClock_advance(uint64_T ns) {
+	__atomic_store_n(&virtual_now, ns, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,34 @@
+/**
+ * @file
+ * @brief Virtual clock of the whole-deployment simulation
+ * @details If the containers are compiled with MCC_SIMULATION, all ECUs of a deployment run in one process
+ * and are stepped by the discrete-event scheduler of the generated simulation.c. The scheduler advances this
+ * clock to the start of every step, so the timestamps of the TraceRecorder are virtual time and the latency of
+ * a message between ECUs does not depend on the speed of the host.
+ * There is only one clock per process, SimulationClock.c is linked into the simulation and not into the ECUs.
+ */
+#ifndef SIMULATIONCLOCK_H_
+#define SIMULATIONCLOCK_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "standardTypes.h"
+
+/**
+ * @brief The current virtual time in ns since the start of the simulation
+ */
+uint64_T SimulationClock_now(void);
+
+/**
+ * @brief Advances the virtual time, called by the scheduler only
+ *
+ * @param ns the new virtual time, never less than the current one
+ */
+void SimulationClock_advance(uint64_T ns);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* SIMULATIONCLOCK_H_ */
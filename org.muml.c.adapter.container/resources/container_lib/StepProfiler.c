@@ -0,0 +1,189 @@
+/*
+ * StepProfiler.c
+ *
+ * Histograms of the step times of the component instances and of the container calls
+ */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "StepProfiler.h"
+#include "AsyncLog.h"
+
+static StepProfile profiles[MCC_PROFILE_MAX_ENTRIES];
+static uint32_T profile_count = 0;
+
+//time spent in container calls of each kind during the current step of an instance
+static uint64_T container_time[STEP_PROFILE_KINDS];
+//depth of nested container calls, only the outermost one counts as container time
+static uint32_T container_depth = 0;
+
+static uint64_T cycles = 0;
+static volatile sig_atomic_t dump_requested = 0;
+
+uint64_T StepProfiler_now(void) {
+#if defined(MCC_PROFILE_RDTSC) && (defined(__x86_64__) || defined(__i386__))
+	return __builtin_ia32_rdtsc();
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_T) ts.tv_sec * 1000000000u + (uint64_T) ts.tv_nsec;
+#endif
+}
+
+StepProfile* StepProfiler_register(const char* name) {
+	uint32_T i;
+	uint32_T n = __atomic_load_n(&profile_count, __ATOMIC_ACQUIRE);
+	for (i = 0; i < n; i++) {
+		if (profiles[i].name != NULL && strcmp(profiles[i].name, name) == 0) {
+			return &profiles[i];
+		}
+	}
+	i = __atomic_fetch_add(&profile_count, 1, __ATOMIC_ACQ_REL);
+	if (i >= MCC_PROFILE_MAX_ENTRIES) {
+		__atomic_fetch_sub(&profile_count, 1, __ATOMIC_RELAXED);
+		return NULL;
+	}
+	profiles[i].name = name;
+	return &profiles[i];
+}
+
+void StepProfiler_record(StepProfile* profile, uint64_T duration) {
+	uint32_T bucket = duration == 0 ? 0 : 64 - __builtin_clzll(duration);
+	if (profile == NULL) {
+		return;
+	}
+	if (bucket >= MCC_PROFILE_BUCKETS) {
+		bucket = MCC_PROFILE_BUCKETS - 1;
+	}
+	//single writer: plain read-modify-write with relaxed stores, so a concurrent dump sees whole values
+	__atomic_store_n(&profile->count, profile->count + 1, __ATOMIC_RELAXED);
+	__atomic_store_n(&profile->sum, profile->sum + duration, __ATOMIC_RELAXED);
+	__atomic_store_n(&profile->buckets[bucket], profile->buckets[bucket] + 1, __ATOMIC_RELAXED);
+	if (duration > profile->max) {
+		__atomic_store_n(&profile->max, duration, __ATOMIC_RELAXED);
+	}
+}
+
+static const char* copyName(const char* instance, const char* suffix) {
+	size_t length = strlen(instance) + strlen(suffix) + 2;
+	char* name = malloc(length);
+	if (name != NULL) {
+		snprintf(name, length, "%s %s", instance, suffix);
+	}
+	return name;
+}
+
+static StepProfile* registerCopy(const char* instance, const char* suffix) {
+	const char* name = copyName(instance, suffix);
+	return name == NULL ? NULL : StepProfiler_register(name);
+}
+
+void StepProfiler_registerInstance(StepProfileInstance* instance, const char* name) {
+	instance->step = registerCopy(name, "step");
+	instance->logic = registerCopy(name, "statechart");
+	instance->calls[STEP_PROFILE_RECEIVE] = registerCopy(name, "receive");
+	instance->calls[STEP_PROFILE_SEND] = registerCopy(name, "send");
+}
+
+uint64_T StepProfiler_beginStep(void) {
+	memset(container_time, 0, sizeof(container_time));
+	return StepProfiler_now();
+}
+
+void StepProfiler_endStep(const StepProfileInstance* instance, uint64_T start) {
+	uint64_T duration = StepProfiler_now() - start;
+	uint64_T calls = 0;
+	int kind;
+	for (kind = 0; kind < STEP_PROFILE_KINDS; kind++) {
+		StepProfiler_record(instance->calls[kind], container_time[kind]);
+		calls += container_time[kind];
+	}
+	StepProfiler_record(instance->step, duration);
+	StepProfiler_record(instance->logic, duration > calls ? duration - calls : 0);
+}
+
+StepProfileScope StepProfiler_enter(StepProfile** profile, const char* name, StepProfileKind kind) {
+	StepProfileScope scope;
+	if (*profile == NULL) {
+		*profile = StepProfiler_register(name);
+	}
+	container_depth++;
+	scope.profile = *profile;
+	scope.kind = kind;
+	scope.start = StepProfiler_now();
+	return scope;
+}
+
+void StepProfiler_leave(StepProfileScope* scope) {
+	uint64_T duration = StepProfiler_now() - scope->start;
+	StepProfiler_record(scope->profile, duration);
+	//a receiveAll calls the single receive, only the outermost call counts
+	if (--container_depth == 0) {
+		container_time[scope->kind] += duration;
+	}
+}
+
+static void request_dump(int signum) {
+	(void) signum;
+	dump_requested = 1;
+}
+
+void StepProfiler_install(void) {
+	struct sigaction action;
+	action.sa_handler = &request_dump;
+	sigemptyset(&action.sa_mask);
+	action.sa_flags = SA_RESTART;
+	sigaction(MCC_PROFILE_SIGNAL, &action, NULL);
+}
+
+void StepProfiler_endCycle(void) {
+	cycles++;
+	//the dump is logged by the thread of the instances, neither printf nor MCC_LOG are async-signal-safe
+	if (dump_requested || (MCC_PROFILE_DUMP_CYCLES > 0 && cycles % MCC_PROFILE_DUMP_CYCLES == 0)) {
+		dump_requested = 0;
+		StepProfiler_dump();
+	}
+}
+
+/*
+ * The upper bound of the bucket, which contains the given fraction of the samples, at most the maximum
+ */
+static uint64_T percentile(const StepProfile* profile, uint64_T count, uint32_T permille) {
+	uint64_T rank = (count * permille + 999) / 1000;
+	uint64_T max = __atomic_load_n(&profile->max, __ATOMIC_RELAXED);
+	uint64_T seen = 0;
+	uint64_T bound;
+	uint32_T b;
+	for (b = 0; b < MCC_PROFILE_BUCKETS - 1; b++) {
+		seen += __atomic_load_n(&profile->buckets[b], __ATOMIC_RELAXED);
+		if (seen >= rank) {
+			bound = b == 0 ? 0 : ((uint64_T) 1 << b) - 1;
+			return bound < max ? bound : max;
+		}
+	}
+	return max;
+}
+
+void StepProfiler_dump(void) {
+	uint32_T n = __atomic_load_n(&profile_count, __ATOMIC_ACQUIRE);
+	uint32_T i;
+	uint64_T count;
+	MCC_LOG("profile after %llu cycles: count mean p50 p99 max\n", (unsigned long long) cycles);
+	for (i = 0; i < n; i++) {
+		count = __atomic_load_n(&profiles[i].count, __ATOMIC_RELAXED);
+		if (count == 0) {
+			continue;
+		}
+		MCC_LOG("profile %s: %llu %llu %llu %llu %llu\n", profiles[i].name, (unsigned long long) count,
+				(unsigned long long) (__atomic_load_n(&profiles[i].sum, __ATOMIC_RELAXED) / count),
+				(unsigned long long) percentile(&profiles[i], count, 500),
+				(unsigned long long) percentile(&profiles[i], count, 990),
+				(unsigned long long) __atomic_load_n(&profiles[i].max, __ATOMIC_RELAXED));
+	}
+	fflush(stdout);
+}
@@ -0,0 +1,142 @@
+/**
+ * @file
+ * @brief Step-time profiling of the component instances of an ECU
+ * @details If the container is compiled with MCC_PROFILE, the step of every component instance and every call of a
+ * generated send, receive or check method is timed and recorded into a histogram of power-of-two buckets.
+ * The step of an instance is split into the time spent in receive calls, in send calls and the rest, the statechart logic.
+ * A summary is printed every MCC_PROFILE_DUMP_CYCLES cycles and whenever the process receives MCC_PROFILE_SIGNAL.
+ * Without MCC_PROFILE the probes expand to nothing.
+ */
+#ifndef STEPPROFILER_H_
+#define STEPPROFILER_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "standardTypes.h"
+
+#ifndef MCC_PROFILE_MAX_ENTRIES
+#define MCC_PROFILE_MAX_ENTRIES 256 /**< the number of StepProfile%s of an ECU */
+#endif
+
+#ifndef MCC_PROFILE_DUMP_CYCLES
+#define MCC_PROFILE_DUMP_CYCLES 10000 /**< cycles between two summaries, 0: only on MCC_PROFILE_SIGNAL */
+#endif
+
+#ifndef MCC_PROFILE_SIGNAL
+#define MCC_PROFILE_SIGNAL SIGUSR2 /**< the signal, which requests a summary */
+#endif
+
+#define MCC_PROFILE_BUCKETS 64
+
+/**
+ * @brief The histogram of the durations of one profiled code section
+ * @details Only written by the thread executing the component instances. The fields are updated with relaxed
+ * atomics, so a summary can be taken at any time without locking; it may mix two consecutive samples
+ */
+typedef struct StepProfile {
+	const char* name; /**< the section, e.g. the component instance or the port method */
+	uint64_T count; /**< the number of samples */
+	uint64_T sum; /**< the sum of all durations */
+	uint64_T max; /**< the longest duration */
+	uint64_T buckets[MCC_PROFILE_BUCKETS]; /**< bucket b counts the durations in [2^(b-1), 2^b), bucket 0 the durations of 0 */
+} StepProfile;
+
+/**
+ * @brief The kinds of container calls, a check for a message counts as receive
+ */
+typedef enum StepProfileKind {
+	STEP_PROFILE_RECEIVE, STEP_PROFILE_SEND, STEP_PROFILE_KINDS
+} StepProfileKind;
+
+/**
+ * @brief The StepProfile%s of one component instance
+ */
+typedef struct StepProfileInstance {
+	StepProfile* step; /**< the whole step */
+	StepProfile* logic; /**< the step without the container calls */
+	StepProfile* calls[STEP_PROFILE_KINDS]; /**< the sum of the container calls of one kind during a step */
+} StepProfileInstance;
+
+/**
+ * @brief A running measurement of a container method, see MCC_PROFILE_SCOPE
+ */
+typedef struct StepProfileScope {
+	StepProfile* profile;
+	StepProfileKind kind;
+	uint64_T start;
+} StepProfileScope;
+
+/**
+ * @brief The current time, ns of CLOCK_MONOTONIC or, with MCC_PROFILE_RDTSC on x86, cycles of the time stamp counter
+ */
+uint64_T StepProfiler_now(void);
+
+/**
+ * @brief Returns the StepProfile of a section, a new one if the name has not been registered yet
+ * @details The name is not copied. Thread safe, NULL if all MCC_PROFILE_MAX_ENTRIES are taken
+ */
+StepProfile* StepProfiler_register(const char* name);
+
+/**
+ * @brief Adds a duration to a StepProfile
+ */
+void StepProfiler_record(StepProfile* profile, uint64_T duration);
+
+/**
+ * @brief Registers the StepProfile%s of a component instance, named after the instance
+ * @details The name is copied, the profiles keep it for the lifetime of the process
+ */
+void StepProfiler_registerInstance(StepProfileInstance* instance, const char* name);
+
+/**
+ * @brief Starts the step of a component instance, resets the time spent in container calls
+ */
+uint64_T StepProfiler_beginStep(void);
+
+/**
+ * @brief Ends the step of a component instance
+ * @param start the result of StepProfiler_beginStep
+ */
+void StepProfiler_endStep(const StepProfileInstance* instance, uint64_T start);
+
+/**
+ * @brief Starts the measurement of a container method, the StepProfile is registered on the first call
+ */
+StepProfileScope StepProfiler_enter(StepProfile** profile, const char* name, StepProfileKind kind);
+
+/**
+ * @brief Ends the measurement of a container method, the duration also counts as container time of the step
+ */
+void StepProfiler_leave(StepProfileScope* scope);
+
+/**
+ * @brief Installs the handler of MCC_PROFILE_SIGNAL
+ */
+void StepProfiler_install(void);
+
+/**
+ * @brief Called at the end of every cycle, prints a summary every MCC_PROFILE_DUMP_CYCLES cycles or if requested by the signal
+ */
+void StepProfiler_endCycle(void);
+
+/**
+ * @brief Prints count, mean, median, 99th percentile and maximum of every StepProfile
+ * @details The percentiles are the upper bounds of their buckets
+ */
+void StepProfiler_dump(void);
+
+#ifdef MCC_PROFILE
+#define MCC_PROFILE_SCOPE(name, kind) \
+	static StepProfile* mcc_profile = NULL; \
+	StepProfileScope mcc_profile_scope __attribute__((cleanup(StepProfiler_leave))) = StepProfiler_enter(&mcc_profile, (name), (kind))
+#else
+#define MCC_PROFILE_SCOPE(name, kind)
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STEPPROFILER_H_ */
@@ -0,0 +1,159 @@
+/*
+ * TraceRecorder.c
+ *
+ * The ring is a bounded multi-producer queue: a producer claims a slot by advancing
+ * ring_head, if the sequence number of the slot shows that the flush thread has
+ * released it. The flush thread is the only consumer.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "TraceRecorder.h"
+#include "AsyncLog.h"
+#ifdef MCC_SIMULATION
+#include "SimulationClock.h"
+#endif
+
+#define TRACE_FLUSH_INTERVAL_NS 10000000
+
+struct trace_slot {
+	uint64_T seq;
+	TraceRecord record;
+};
+
+static struct trace_slot ring[MCC_TRACE_RING_SIZE];
+static uint64_T ring_head = 0;
+static uint64_T ring_tail = 0;
+static uint64_T dropped = 0;
+static bool_t recording = false;
+
+static FILE* trace_file = NULL;
+static pthread_t flush_thread;
+static bool_t flush_running = false;
+
+static uint64_T now(void) {
+#ifdef MCC_SIMULATION
+	return SimulationClock_now();
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_T) ts.tv_sec * 1000000000u + (uint64_T) ts.tv_nsec;
+#endif
+}
+
+void TraceRecorder_record(TraceEventKind kind, const void* ref, uint16_T bufferID, uint16_T msgID,
+		const void* msg, size_t size) {
+	struct trace_slot* slot;
+	uint64_T pos;
+	int64_T dif;
+
+	if (!__atomic_load_n(&recording, __ATOMIC_RELAXED)) {
+		return;
+	}
+	pos = __atomic_load_n(&ring_head, __ATOMIC_RELAXED);
+	for (;;) {
+		slot = &ring[pos & (MCC_TRACE_RING_SIZE - 1)];
+		dif = (int64_T) __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) - (int64_T) pos;
+		if (dif == 0) {
+			if (__atomic_compare_exchange_n(&ring_head, &pos, pos + 1, true,
+					__ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+				break;
+			}
+		} else if (dif < 0) {
+			//the flush thread did not release the slot yet
+			__atomic_add_fetch(&dropped, 1, __ATOMIC_RELAXED);
+			return;
+		} else {
+			pos = __atomic_load_n(&ring_head, __ATOMIC_RELAXED);
+		}
+	}
+	slot->record.timestamp = now();
+	slot->record.ref = (uint64_T) (size_t) ref;
+	slot->record.kind = (uint16_T) kind;
+	slot->record.bufferID = bufferID;
+	slot->record.msgID = msgID;
+	slot->record.size = (uint16_T) size;
+	if (msg != NULL) {
+		memcpy(slot->record.payload, msg, size < MCC_TRACE_PAYLOAD_SIZE ? size : MCC_TRACE_PAYLOAD_SIZE);
+	}
+	__atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+}
+
+static void drain(void) {
+	struct trace_slot* slot;
+
+	for (;;) {
+		slot = &ring[ring_tail & (MCC_TRACE_RING_SIZE - 1)];
+		if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != ring_tail + 1) {
+			break;
+		}
+		fwrite(&slot->record, sizeof(TraceRecord), 1, trace_file);
+		//release the slot for the next round of the producers
+		__atomic_store_n(&slot->seq, ring_tail + MCC_TRACE_RING_SIZE, __ATOMIC_RELEASE);
+		ring_tail++;
+	}
+	fflush(trace_file);
+}
+
+static void* flush(void* arg) {
+	struct timespec interval = { 0, TRACE_FLUSH_INTERVAL_NS };
+
+	while (__atomic_load_n(&flush_running, __ATOMIC_ACQUIRE)) {
+		drain();
+		nanosleep(&interval, NULL);
+	}
+	drain();
+	return NULL;
+}
+
+int TraceRecorder_open(const char* path) {
+	TraceFileHeader header;
+	uint64_T i;
+
+	if (trace_file != NULL) {
+		return -1;
+	}
+	trace_file = fopen(path, "wb");
+	if (trace_file == NULL) {
+		MCC_LOG("TraceRecorder: cannot open %s\n", path);
+		return -1;
+	}
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, MCC_TRACE_MAGIC, sizeof(header.magic));
+	header.version = MCC_TRACE_VERSION;
+	header.recordSize = sizeof(TraceRecord);
+	header.payloadSize = MCC_TRACE_PAYLOAD_SIZE;
+	fwrite(&header, sizeof(header), 1, trace_file);
+
+	for (i = 0; i < MCC_TRACE_RING_SIZE; i++) {
+		ring[i].seq = i;
+	}
+	ring_head = 0;
+	ring_tail = 0;
+	flush_running = true;
+	if (pthread_create(&flush_thread, NULL, &flush, NULL) != 0) {
+		MCC_LOG("TraceRecorder: cannot start the flush thread\n");
+		flush_running = false;
+		fclose(trace_file);
+		trace_file = NULL;
+		return -1;
+	}
+	__atomic_store_n(&recording, true, __ATOMIC_RELEASE);
+	return 0;
+}
+
+void TraceRecorder_close(void) {
+	if (trace_file == NULL) {
+		return;
+	}
+	__atomic_store_n(&recording, false, __ATOMIC_RELEASE);
+	__atomic_store_n(&flush_running, false, __ATOMIC_RELEASE);
+	pthread_join(flush_thread, NULL);
+	fclose(trace_file);
+	trace_file = NULL;
+}
+
+uint64_T TraceRecorder_getDropped(void) {
+	return __atomic_load_n(&dropped, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,99 @@
+/**
+ * @file
+ * @brief Binary trace of the message traffic of an ECU
+ * @details If the container is compiled with MCC_TRACE, every publish, enqueue, dequeue and DDS write/take
+ * is recorded into a lock-free in-memory ring, which is flushed by a background thread into a binary file.
+ * The file consists of a TraceFileHeader followed by TraceRecord%s of fixed size, so it can be mapped into memory.
+ * Without MCC_TRACE the trace points expand to nothing.
+ */
+#ifndef TRACERECORDER_H_
+#define TRACERECORDER_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "standardTypes.h"
+
+#ifndef MCC_TRACE_PAYLOAD_SIZE
+#define MCC_TRACE_PAYLOAD_SIZE 64 /**< bytes of a message stored in a TraceRecord, larger messages are truncated */
+#endif
+
+#ifndef MCC_TRACE_RING_SIZE
+#define MCC_TRACE_RING_SIZE 4096 /**< number of TraceRecord%s in the ring, must be a power of two */
+#endif
+
+#define MCC_TRACE_MAGIC "MCCTRACE"
+#define MCC_TRACE_VERSION 1
+
+/**
+ * @brief The kinds of events that are recorded
+ */
+typedef enum {
+	TRACE_PUBLISH = 1, /**< publishMessage was called */
+	TRACE_ENQUEUE, /**< a message was stored in a MessageBuffer */
+	TRACE_DROP, /**< a message was discarded, because the MessageBuffer was full */
+	TRACE_DEQUEUE, /**< a message was taken from a MessageBuffer */
+	TRACE_DDS_WRITE, /**< a message was written to a DDS DataWriter */
+	TRACE_DDS_TAKE, /**< a message was taken from a DDS DataReader */
+	TRACE_CYCLE /**< a new cycle of the process loop starts */
+} TraceEventKind;
+
+/**
+ * @brief The header at the start of a trace file
+ */
+typedef struct TraceFileHeader {
+	char magic[8]; /**< MCC_TRACE_MAGIC */
+	uint32_T version; /**< MCC_TRACE_VERSION */
+	uint32_T recordSize; /**< sizeof(TraceRecord) of the writer */
+	uint32_T payloadSize; /**< MCC_TRACE_PAYLOAD_SIZE of the writer */
+	uint32_T reserved;
+} TraceFileHeader;
+
+/**
+ * @brief A single recorded event
+ */
+typedef struct TraceRecord {
+	uint64_T timestamp; /**< CLOCK_MONOTONIC in ns, the SimulationClock with MCC_SIMULATION */
+	uint64_T ref; /**< the MessageBuffer or DDS entity the event belongs to */
+	uint16_T kind; /**< the TraceEventKind */
+	uint16_T bufferID; /**< the bufferID of a publish */
+	uint16_T msgID; /**< the message identifier */
+	uint16_T size; /**< the size of the message, may exceed MCC_TRACE_PAYLOAD_SIZE */
+	uint8_T payload[MCC_TRACE_PAYLOAD_SIZE]; /**< the first bytes of the message */
+} TraceRecord;
+
+/**
+ * @brief Starts recording into a file, the file is overwritten
+ * @return 0 on success, otherwise -1
+ */
+int TraceRecorder_open(const char* path);
+
+/**
+ * @brief Records an event, never blocks
+ * @details If the ring is full, the event is dropped and counted
+ */
+void TraceRecorder_record(TraceEventKind kind, const void* ref, uint16_T bufferID, uint16_T msgID,
+		const void* msg, size_t size);
+
+/**
+ * @brief Flushes all recorded events and closes the file
+ */
+void TraceRecorder_close(void);
+
+/**
+ * @brief The number of events dropped, because the ring was full
+ */
+uint64_T TraceRecorder_getDropped(void);
+
+#ifdef MCC_TRACE
+#define MCC_TRACE_EVENT(kind, ref, bufferID, msgID, msg, size) \
+	TraceRecorder_record((kind), (ref), (bufferID), (msgID), (msg), (size))
+#else
+#define MCC_TRACE_EVENT(kind, ref, bufferID, msgID, msg, size)
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* TRACERECORDER_H_ */
@@ -0,0 +1,86 @@
+/*
+ * TraceReplay.c
+ */
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "TraceReplay.h"
+#include "LocalBufferManager.h"
+#include "AsyncLog.h"
+
+static uint64_T now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_T) ts.tv_sec * 1000000000u + (uint64_T) ts.tv_nsec;
+}
+
+int TraceReplay_run(const char* path, void (*step)(void), TraceReplayStatistics* stats) {
+	TraceReplayStatistics s = { 0, 0, 0, 0 };
+	const TraceFileHeader* header;
+	const TraceRecord* record;
+	struct stat st;
+	size_t count, i;
+	void* data;
+	uint64_T start;
+	int fd;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		MCC_LOG("TraceReplay: cannot open %s\n", path);
+		return -1;
+	}
+	if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(TraceFileHeader)) {
+		MCC_LOG("TraceReplay: %s is no trace file\n", path);
+		close(fd);
+		return -1;
+	}
+	data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) {
+		MCC_LOG("TraceReplay: cannot map %s\n", path);
+		return -1;
+	}
+	header = (const TraceFileHeader*) data;
+	if (memcmp(header->magic, MCC_TRACE_MAGIC, sizeof(header->magic)) != 0
+			|| header->version != MCC_TRACE_VERSION
+			|| header->recordSize != sizeof(TraceRecord)) {
+		MCC_LOG("TraceReplay: %s was recorded with another format\n", path);
+		munmap(data, st.st_size);
+		return -1;
+	}
+	count = (st.st_size - sizeof(TraceFileHeader)) / sizeof(TraceRecord);
+	record = (const TraceRecord*) (header + 1);
+
+	LocalBufferManager_setMuted(true);
+	start = now();
+	for (i = 0; i < count; i++, record++) {
+		switch (record->kind) {
+		case TRACE_PUBLISH:
+			if (record->size > MCC_TRACE_PAYLOAD_SIZE) {
+				s.skipped++;
+			} else {
+				LocalBufferManager_deliver(record->bufferID, record->msgID, record->payload);
+				s.messages++;
+			}
+			break;
+		case TRACE_CYCLE:
+			step();
+			s.cycles++;
+			break;
+		default:
+			break;
+		}
+	}
+	s.durationNs = now() - start;
+	LocalBufferManager_setMuted(false);
+
+	munmap(data, st.st_size);
+	if (stats != NULL) {
+		*stats = s;
+	}
+	return 0;
+}
@@ -0,0 +1,40 @@
+/**
+ * @file
+ * @brief Replay of a trace recorded by the TraceRecorder
+ * @details The recorded publishes are fed into the local MessageBuffer%s at full speed, while the messages
+ * published by the component instances are muted, so that they process exactly the recorded traffic.
+ */
+#ifndef TRACEREPLAY_H_
+#define TRACEREPLAY_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "TraceRecorder.h"
+
+/**
+ * @brief Statistics of a replay
+ */
+typedef struct TraceReplayStatistics {
+	uint64_T cycles; /**< the number of replayed cycles */
+	uint64_T messages; /**< the number of replayed publishes */
+	uint64_T skipped; /**< publishes which were truncated by the recorder and could not be replayed */
+	uint64_T durationNs; /**< the wall time of the replay */
+} TraceReplayStatistics;
+
+/**
+ * @brief Replays a trace file
+ * @details Every recorded publish is delivered to the subscribers of this process, step is called for every recorded cycle
+ *
+ * @param path the trace file
+ * @param step executes one cycle of all component instances
+ * @param stats filled with the statistics of the replay, may be NULL
+ * @return 0 on success, -1 if the file could not be read
+ */
+int TraceReplay_run(const char* path, void (*step)(void), TraceReplayStatistics* stats);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* TRACEREPLAY_H_ */
@@ -0,0 +1,128 @@
+/**
+ * @file
+ * @brief Type-specialized access to MessageBuffer%s
+ * @details The generic MessageBuffer copies with memcpy and a size that is only known at runtime. The macros of
+ * this file define static inline functions for one message type, so the compiler copies a message by assignment
+ * and, for a known capacity, wraps the ring without loading MessageBuffer::buffer_end and MessageBuffer::elementSize.
+ * The functions operate on the same MessageBuffer struct, so they can be mixed with the generic functions.
+ */
+#ifndef TYPEDMESSAGEBUFFER_H_
+#define TYPEDMESSAGEBUFFER_H_
+
+#include "MessageBuffer.h"
+#include "LocalBufferManager.h"
+#include "TraceRecorder.h"
+#include "ContainerProbes.h"
+
+/**
+ * @brief Defines Name_enqueue and Name_publish for messages of type T
+ * @details The capacity is read from the MessageBuffer, because the subscribers of a message may use different
+ * capacities. A conflating MessageBuffer replaces the pending message with the same key.
+ * Name_publish behaves like publishMessage and returns its DeliveryReport. Both fire the same probes as
+ * MessageBuffer_enqueue and publishMessage.
+ */
+#define MESSAGEBUFFER_DEFINE_TYPED(Name, T) \
+static inline bool_t Name##_enqueue(MessageBuffer* buf, const T* msg) { \
+	T* tail = (T*) buf->tail; \
+	T* pending; \
+	if (buf->keySize != 0 && (pending = (T*) MessageBuffer_findPending(buf, msg)) != NULL) { \
+		MCC_TRACE_EVENT(TRACE_ENQUEUE, buf, 0, 0, msg, sizeof(T)); \
+		MCC_PROBE2(enqueue_conflate, buf, pending); \
+		*pending = *msg; \
+		return true; \
+	} \
+	if (buf->count < buf->capacity) { \
+		MCC_PROBE3(enqueue, buf, tail, buf->count + 1); \
+		buf->count++; \
+		if (buf->pendingMask != NULL) { \
+			*buf->pendingMask |= buf->pendingBit; \
+		} \
+	} else if (!buf->bufferMode) { \
+		MCC_TRACE_EVENT(TRACE_DROP, buf, 0, 0, msg, sizeof(T)); \
+		MCC_PROBE2(enqueue_drop, buf, msg); \
+		return false; \
+	} else { \
+		MCC_PROBE2(enqueue_overwrite, buf, tail); \
+	} \
+	MCC_TRACE_EVENT(TRACE_ENQUEUE, buf, 0, 0, msg, sizeof(T)); \
+	*tail = *msg; \
+	tail = (tail + 1 == (T*) buf->buffer + buf->capacity) ? (T*) buf->buffer : tail + 1; \
+	buf->tail = tail; \
+	if (buf->count == buf->capacity) { \
+		/* full: the oldest message is the next one to be replaced */ \
+		buf->head = tail; \
+	} \
+	return true; \
+} \
+static inline DeliveryReport Name##_publish(uint16_T bufferID, uint16_T msgID, const T* msg) { \
+	DeliveryReport report = { 0, 0, 0 }; \
+	bool_t locked; \
+	LocalSubscriberList* lst; \
+	MCC_PROBE3(publish_entry, bufferID, msgID, msg); \
+	if (!LocalBufferManager_isMuted()) { \
+		lst = LocalBufferManager_lockSubscribers(bufferID, msgID, &locked); \
+		MCC_TRACE_EVENT(TRACE_PUBLISH, NULL, bufferID, msgID, msg, sizeof(T)); \
+		if (LocalBufferManager_admit(lst, msg, &report)) { \
+			for (; lst != NULL; lst = lst->next) { \
+				if (LocalSubscriber_accepts(lst->subscriber, msg)) { \
+					DeliveryReport_record(&report, Name##_enqueue(lst->subscriber->buffer, msg)); \
+				} \
+			} \
+		} \
+		LocalBufferManager_unlockSubscribers(locked); \
+	} \
+	MCC_PROBE4(publish_return, bufferID, msgID, report.delivered, report.droppedMask); \
+	return report; \
+}
+
+/**
+ * @brief Defines Name_dequeue, Name_dequeueBulk and Name_exists for a MessageBuffer of N messages of type T
+ * @details Only use them for MessageBuffer%s that have been created with capacity N and elementSize sizeof(T).
+ * Name_dequeueBulk copies up to max messages with at most two memcpys, see MessageBuffer_dequeueBulk
+ */
+#define MESSAGEBUFFER_DEFINE_TYPED_RING(Name, T, N) \
+static inline bool_t Name##_dequeue(MessageBuffer* buf, T* msg) { \
+	T* head = (T*) buf->head; \
+	if (buf->count == 0) { \
+		return false; \
+	} \
+	*msg = *head; \
+	MCC_TRACE_EVENT(TRACE_DEQUEUE, buf, 0, 0, msg, sizeof(T)); \
+	MCC_PROBE3(dequeue, buf, head, buf->count - 1); \
+	buf->head = (head + 1 == (T*) buf->buffer + (N)) ? (T*) buf->buffer : head + 1; \
+	buf->count--; \
+	if (buf->count == 0 && buf->pendingMask != NULL) { \
+		*buf->pendingMask &= ~buf->pendingBit; \
+	} \
+	return true; \
+} \
+static inline size_t Name##_dequeueBulk(MessageBuffer* buf, T* msgs, size_t max) { \
+	T* head = (T*) buf->head; \
+	size_t n = buf->count < max ? buf->count : max; \
+	size_t first = (size_t) ((T*) buf->buffer + (N) - head); \
+	size_t i; \
+	if (n == 0) { \
+		return 0; \
+	} \
+	if (first > n) { \
+		first = n; \
+	} \
+	memcpy(msgs, head, first * sizeof(T)); \
+	memcpy(msgs + first, buf->buffer, (n - first) * sizeof(T)); \
+	for (i = 0; i < n; i++) { \
+		MCC_TRACE_EVENT(TRACE_DEQUEUE, buf, 0, 0, &msgs[i], sizeof(T)); \
+		MCC_PROBE3(dequeue, buf, i < first ? head + i : (T*) buf->buffer + (i - first), buf->count - i - 1); \
+	} \
+	head += first; \
+	buf->head = (head == (T*) buf->buffer + (N)) ? (T*) buf->buffer + (n - first) : head; \
+	buf->count -= n; \
+	if (buf->count == 0 && buf->pendingMask != NULL) { \
+		*buf->pendingMask &= ~buf->pendingBit; \
+	} \
+	return n; \
+} \
+static inline bool_t Name##_exists(MessageBuffer* buf) { \
+	return buf->count > 0; \
+}
+
+#endif /* TYPEDMESSAGEBUFFER_H_ */
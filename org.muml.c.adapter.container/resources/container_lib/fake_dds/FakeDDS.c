@@ -0,0 +1,898 @@
+/*
+ * FakeDDS.c
+ *
+ * In-process implementation of ndds/ndds_c.h. All entities live in one list of DomainParticipants guarded by
+ * a recursive mutex, so listeners may call back into the API. Every DataWriter keeps the DataReaders it matched,
+ * so a write only visits its own subscribers.
+ */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <pthread.h>
+#include "ndds/ndds_c.h"
+
+struct type_node {
+	char* name;
+	size_t size;
+	struct type_node* next;
+};
+
+struct DDS_DomainParticipantImpl {
+	DDS_DomainId_t domainId;
+	struct type_node* types;
+	DDS_Topic* topics;
+	DDS_Publisher* publishers;
+	DDS_Subscriber* subscribers;
+	DDS_DomainParticipant* next;
+};
+
+struct DDS_TopicImpl {
+	DDS_DomainParticipant* participant;
+	char* name;
+	size_t size;
+	DDS_Topic* next;
+};
+
+struct DDS_PublisherImpl {
+	DDS_DomainParticipant* participant;
+	struct DDS_StringSeq partition;
+	struct DDS_DataWriterListener listener;
+	DDS_StatusMask mask;
+	DDS_DataWriter* writers;
+	DDS_Publisher* next;
+};
+
+struct DDS_SubscriberImpl {
+	DDS_DomainParticipant* participant;
+	struct DDS_StringSeq partition;
+	struct DDS_DataReaderListener listener;
+	DDS_StatusMask mask;
+	DDS_DataReader* readers;
+	DDS_Subscriber* next;
+};
+
+struct DDS_DataWriterImpl {
+	DDS_Publisher* publisher;
+	DDS_Topic* topic;
+	struct DDS_DataWriterListener listener;
+	DDS_StatusMask mask;
+	DDS_DataReader** matches;
+	DDS_Long matchCount;
+	DDS_Long matchCapacity;
+	DDS_Long totalMatched;
+	DDS_DataWriter* next;
+};
+
+struct DDS_DataReaderImpl {
+	DDS_Subscriber* subscriber;
+	DDS_Topic* topic;
+	struct DDS_DataReaderListener listener;
+	DDS_StatusMask mask;
+	char* samples;
+	DDS_Long capacity;
+	DDS_Long head;
+	DDS_Long count;
+	DDS_Boolean keepLast;
+	DDS_Long totalMatched;
+	DDS_DataReader* next;
+};
+
+const DDS_InstanceHandle_t DDS_HANDLE_NIL = { NULL };
+const struct DDS_TopicQos DDS_TOPIC_QOS_DEFAULT = { 0 };
+
+static DDS_DomainParticipant* participants = NULL;
+static pthread_mutex_t lock;
+static pthread_once_t lock_once = PTHREAD_ONCE_INIT;
+
+static void init_lock(void) {
+	pthread_mutexattr_t attr;
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+	pthread_mutex_init(&lock, &attr);
+	pthread_mutexattr_destroy(&attr);
+}
+
+static void enter(void) {
+	pthread_once(&lock_once, &init_lock);
+	pthread_mutex_lock(&lock);
+}
+
+static void leave(void) {
+	pthread_mutex_unlock(&lock);
+}
+
+/* strings and sequences */
+
+char* DDS_String_dup(const char* str) {
+	return str != NULL ? strdup(str) : NULL;
+}
+
+DDS_Boolean DDS_StringSeq_ensure_length(struct DDS_StringSeq* seq, DDS_Long length, DDS_Long max) {
+	char** buffer;
+	DDS_Long i;
+
+	if (length > max) {
+		return DDS_BOOLEAN_FALSE;
+	}
+	if (max > seq->maximum) {
+		buffer = (char**) realloc(seq->buffer, max * sizeof(char*));
+		if (buffer == NULL) {
+			return DDS_BOOLEAN_FALSE;
+		}
+		for (i = seq->maximum; i < max; i++) {
+			buffer[i] = NULL;
+		}
+		seq->buffer = buffer;
+		seq->maximum = max;
+	}
+	seq->length = length;
+	return DDS_BOOLEAN_TRUE;
+}
+
+char** DDS_StringSeq_get_reference(struct DDS_StringSeq* seq, DDS_Long i) {
+	return i < seq->length ? &seq->buffer[i] : NULL;
+}
+
+DDS_Long DDS_StringSeq_get_length(const struct DDS_StringSeq* seq) {
+	return seq->length;
+}
+
+DDS_InstanceHandle_t* DDS_InstanceHandleSeq_get_reference(struct DDS_InstanceHandleSeq* seq, DDS_Long i) {
+	return i < seq->length ? &seq->buffer[i] : NULL;
+}
+
+DDS_Long DDS_InstanceHandleSeq_get_length(const struct DDS_InstanceHandleSeq* seq) {
+	return seq->length;
+}
+
+void DDS_InstanceHandleSeq_finalize(struct DDS_InstanceHandleSeq* seq) {
+	free(seq->buffer);
+	seq->buffer = NULL;
+	seq->length = 0;
+	seq->maximum = 0;
+}
+
+DDS_Boolean DDS_InstanceHandle_equals(const DDS_InstanceHandle_t* self, const DDS_InstanceHandle_t* other) {
+	return self->entity == other->entity;
+}
+
+/* the instance handle of an entity is its address */
+DDS_InstanceHandle_t DDS_Entity_get_instance_handle(DDS_Entity* entity) {
+	DDS_InstanceHandle_t handle = { entity };
+	return handle;
+}
+
+void DDS_StringSeq_finalize(struct DDS_StringSeq* seq) {
+	DDS_Long i;
+
+	for (i = 0; i < seq->maximum; i++) {
+		free(seq->buffer[i]);
+	}
+	free(seq->buffer);
+	seq->buffer = NULL;
+	seq->length = 0;
+	seq->maximum = 0;
+}
+
+static void copy_partition(struct DDS_StringSeq* dst, const struct DDS_StringSeq* src) {
+	DDS_Long i;
+
+	DDS_StringSeq_ensure_length(dst, src->length, src->length);
+	for (i = 0; i < src->length; i++) {
+		free(dst->buffer[i]);
+		dst->buffer[i] = DDS_String_dup(src->buffer[i]);
+	}
+}
+
+/* partitions match, if both are the default partition or they share a name */
+static DDS_Boolean partitions_match(const struct DDS_StringSeq* a, const struct DDS_StringSeq* b) {
+	DDS_Long i, j;
+
+	if (a->length == 0 || b->length == 0) {
+		return a->length == b->length;
+	}
+	for (i = 0; i < a->length; i++) {
+		for (j = 0; j < b->length; j++) {
+			if (a->buffer[i] != NULL && b->buffer[j] != NULL && strcmp(a->buffer[i], b->buffer[j]) == 0) {
+				return DDS_BOOLEAN_TRUE;
+			}
+		}
+	}
+	return DDS_BOOLEAN_FALSE;
+}
+
+/* QoS */
+
+DDS_ReturnCode_t DDS_DomainParticipantQos_finalize(struct DDS_DomainParticipantQos* qos) {
+	return DDS_RETCODE_OK;
+}
+
+DDS_ReturnCode_t DDS_PublisherQos_finalize(struct DDS_PublisherQos* qos) {
+	DDS_StringSeq_finalize(&qos->partition.name);
+	return DDS_RETCODE_OK;
+}
+
+DDS_ReturnCode_t DDS_SubscriberQos_finalize(struct DDS_SubscriberQos* qos) {
+	DDS_StringSeq_finalize(&qos->partition.name);
+	return DDS_RETCODE_OK;
+}
+
+DDS_ReturnCode_t DDS_DataWriterQos_finalize(struct DDS_DataWriterQos* qos) {
+	return DDS_RETCODE_OK;
+}
+
+DDS_ReturnCode_t DDS_DataReaderQos_finalize(struct DDS_DataReaderQos* qos) {
+	return DDS_RETCODE_OK;
+}
+
+DDS_ReturnCode_t DDS_DataReaderCacheStatus_finalize(struct DDS_DataReaderCacheStatus* status) {
+	return DDS_RETCODE_OK;
+}
+
+void DDS_PublicationBuiltinTopicData_finalize(struct DDS_PublicationBuiltinTopicData* data) {
+	DDS_StringSeq_finalize(&data->partition.name);
+}
+
+void DDS_SubscriptionBuiltinTopicData_finalize(struct DDS_SubscriptionBuiltinTopicData* data) {
+	DDS_StringSeq_finalize(&data->partition.name);
+}
+
+/* matching */
+
+static void notify_match(DDS_DataWriter* writer, DDS_DataReader* reader) {
+	struct DDS_PublicationMatchedStatus pub_status;
+	struct DDS_SubscriptionMatchedStatus sub_status;
+	struct DDS_LivelinessChangedStatus liveliness;
+	const struct DDS_DataWriterListener* wl = writer->mask != DDS_STATUS_MASK_NONE ? &writer->listener
+			: &writer->publisher->listener;
+	DDS_StatusMask wmask = writer->mask != DDS_STATUS_MASK_NONE ? writer->mask : writer->publisher->mask;
+	const struct DDS_DataReaderListener* rl = reader->mask != DDS_STATUS_MASK_NONE ? &reader->listener
+			: &reader->subscriber->listener;
+	DDS_StatusMask rmask = reader->mask != DDS_STATUS_MASK_NONE ? reader->mask : reader->subscriber->mask;
+
+	memset(&pub_status, 0, sizeof(pub_status));
+	pub_status.total_count = ++writer->totalMatched;
+	pub_status.total_count_change = 1;
+	pub_status.current_count = writer->matchCount;
+	pub_status.current_count_change = 1;
+	pub_status.last_subscription_handle.entity = reader;
+	if ((wmask & DDS_PUBLICATION_MATCHED_STATUS) && wl->on_publication_matched != NULL) {
+		wl->on_publication_matched(wl->as_listener.listener_data, writer, &pub_status);
+	}
+
+	//a reader sees the match first and then the writer becoming alive, like with RTI
+	memset(&sub_status, 0, sizeof(sub_status));
+	sub_status.total_count = ++reader->totalMatched;
+	sub_status.total_count_change = 1;
+	sub_status.current_count = reader->totalMatched;
+	sub_status.current_count_change = 1;
+	sub_status.last_publication_handle.entity = writer;
+	if ((rmask & DDS_SUBSCRIPTION_MATCHED_STATUS) && rl->on_subscription_matched != NULL) {
+		rl->on_subscription_matched(rl->as_listener.listener_data, reader, &sub_status);
+	}
+	memset(&liveliness, 0, sizeof(liveliness));
+	liveliness.alive_count = reader->totalMatched;
+	liveliness.alive_count_change = 1;
+	liveliness.last_publication_handle.entity = writer;
+	if ((rmask & DDS_LIVELINESS_CHANGED_STATUS) && rl->on_liveliness_changed != NULL) {
+		rl->on_liveliness_changed(rl->as_listener.listener_data, reader, &liveliness);
+	}
+}
+
+static DDS_Boolean add_match(DDS_DataWriter* writer, DDS_DataReader* reader) {
+	DDS_DataReader** matches;
+
+	if (writer->topic->participant->domainId != reader->topic->participant->domainId
+			|| strcmp(writer->topic->name, reader->topic->name) != 0
+			|| !partitions_match(&writer->publisher->partition, &reader->subscriber->partition)) {
+		return DDS_BOOLEAN_FALSE;
+	}
+	if (writer->matchCount == writer->matchCapacity) {
+		matches = (DDS_DataReader**) realloc(writer->matches,
+				(writer->matchCapacity + 4) * sizeof(DDS_DataReader*));
+		if (matches == NULL) {
+			return DDS_BOOLEAN_FALSE;
+		}
+		writer->matches = matches;
+		writer->matchCapacity += 4;
+	}
+	writer->matches[writer->matchCount++] = reader;
+	return DDS_BOOLEAN_TRUE;
+}
+
+static void notify_unmatch(DDS_DataWriter* writer, DDS_DataReader* reader) {
+	struct DDS_PublicationMatchedStatus pub_status;
+	const struct DDS_DataWriterListener* wl = writer->mask != DDS_STATUS_MASK_NONE ? &writer->listener
+			: &writer->publisher->listener;
+	DDS_StatusMask wmask = writer->mask != DDS_STATUS_MASK_NONE ? writer->mask : writer->publisher->mask;
+
+	memset(&pub_status, 0, sizeof(pub_status));
+	pub_status.total_count = writer->totalMatched;
+	pub_status.current_count = writer->matchCount;
+	pub_status.current_count_change = -1;
+	pub_status.last_subscription_handle.entity = reader;
+	if ((wmask & DDS_PUBLICATION_MATCHED_STATUS) && wl->on_publication_matched != NULL) {
+		wl->on_publication_matched(wl->as_listener.listener_data, writer, &pub_status);
+	}
+}
+
+static void remove_match(DDS_DataReader* reader) {
+	DDS_DomainParticipant* p;
+	DDS_Publisher* pub;
+	DDS_DataWriter* w;
+	DDS_Long i;
+
+	for (p = participants; p != NULL; p = p->next) {
+		for (pub = p->publishers; pub != NULL; pub = pub->next) {
+			for (w = pub->writers; w != NULL; w = w->next) {
+				for (i = 0; i < w->matchCount; i++) {
+					if (w->matches[i] == reader) {
+						w->matches[i] = w->matches[--w->matchCount];
+						notify_unmatch(w, reader);
+						break;
+					}
+				}
+			}
+		}
+	}
+}
+
+/* DomainParticipantFactory */
+
+DDS_ReturnCode_t DDS_DomainParticipantFactory_get_default_participant_qos(DDS_DomainParticipantFactory* factory,
+		struct DDS_DomainParticipantQos* qos) {
+	memset(qos, 0, sizeof(*qos));
+	return DDS_RETCODE_OK;
+}
+
+DDS_DomainParticipant* DDS_DomainParticipantFactory_create_participant(DDS_DomainParticipantFactory* factory,
+		DDS_DomainId_t domainId, const struct DDS_DomainParticipantQos* qos, const void* listener, DDS_StatusMask mask) {
+	DDS_DomainParticipant* participant = (DDS_DomainParticipant*) calloc(1, sizeof(DDS_DomainParticipant));
+
+	if (participant == NULL) {
+		return NULL;
+	}
+	participant->domainId = domainId;
+	enter();
+	participant->next = participants;
+	participants = participant;
+	leave();
+	return participant;
+}
+
+DDS_ReturnCode_t DDS_DomainParticipantFactory_delete_participant(DDS_DomainParticipantFactory* factory,
+		DDS_DomainParticipant* participant) {
+	DDS_DomainParticipant** lst;
+	struct type_node* type;
+
+	enter();
+	if (participant->publishers != NULL || participant->subscribers != NULL || participant->topics != NULL) {
+		leave();
+		return DDS_RETCODE_PRECONDITION_NOT_MET;
+	}
+	for (lst = &participants; *lst != NULL; lst = &(*lst)->next) {
+		if (*lst == participant) {
+			*lst = participant->next;
+			break;
+		}
+	}
+	leave();
+	while (participant->types != NULL) {
+		type = participant->types;
+		participant->types = type->next;
+		free(type->name);
+		free(type);
+	}
+	free(participant);
+	return DDS_RETCODE_OK;
+}
+
+DDS_ReturnCode_t DDS_DomainParticipantFactory_finalize_instance(void) {
+	return DDS_RETCODE_OK;
+}
+
+/* DomainParticipant */
+
+DDS_ReturnCode_t FakeDDS_register_type(DDS_DomainParticipant* participant, const char* type_name, size_t size) {
+	struct type_node* type;
+
+	enter();
+	for (type = participant->types; type != NULL; type = type->next) {
+		if (strcmp(type->name, type_name) == 0) {
+			leave();
+			return type->size == size ? DDS_RETCODE_OK : DDS_RETCODE_PRECONDITION_NOT_MET;
+		}
+	}
+	type = (struct type_node*) malloc(sizeof(struct type_node));
+	if (type == NULL) {
+		leave();
+		return DDS_RETCODE_ERROR;
+	}
+	type->name = DDS_String_dup(type_name);
+	type->size = size;
+	type->next = participant->types;
+	participant->types = type;
+	leave();
+	return DDS_RETCODE_OK;
+}
+
+DDS_ReturnCode_t DDS_DomainParticipant_get_default_publisher_qos(DDS_DomainParticipant* participant,
+		struct DDS_PublisherQos* qos) {
+	DDS_StringSeq_ensure_length(&qos->partition.name, 0, qos->partition.name.maximum);
+	return DDS_RETCODE_OK;
+}
+
+DDS_ReturnCode_t DDS_DomainParticipant_get_default_subscriber_qos(DDS_DomainParticipant* participant,
+		struct DDS_SubscriberQos* qos) {
+	DDS_StringSeq_ensure_length(&qos->partition.name, 0, qos->partition.name.maximum);
+	return DDS_RETCODE_OK;
+}
+
+DDS_Publisher* DDS_DomainParticipant_create_publisher(DDS_DomainParticipant* participant,
+		const struct DDS_PublisherQos* qos, const struct DDS_PublisherListener* listener, DDS_StatusMask mask) {
+	DDS_Publisher* publisher = (DDS_Publisher*) calloc(1, sizeof(DDS_Publisher));
+
+	if (publisher == NULL) {
+		return NULL;
+	}
+	publisher->participant = participant;
+	copy_partition(&publisher->partition, &qos->partition.name);
+	if (listener != NULL) {
+		publisher->listener = listener->as_datawriterlistener;
+		publisher->mask = mask;
+	}
+	enter();
+	publisher->next = participant->publishers;
+	participant->publishers = publisher;
+	leave();
+	return publisher;
+}
+
+DDS_Subscriber* DDS_DomainParticipant_create_subscriber(DDS_DomainParticipant* participant,
+		const struct DDS_SubscriberQos* qos, const struct DDS_SubscriberListener* listener, DDS_StatusMask mask) {
+	DDS_Subscriber* subscriber = (DDS_Subscriber*) calloc(1, sizeof(DDS_Subscriber));
+
+	if (subscriber == NULL) {
+		return NULL;
+	}
+	subscriber->participant = participant;
+	copy_partition(&subscriber->partition, &qos->partition.name);
+	if (listener != NULL) {
+		subscriber->listener = listener->as_datareaderlistener;
+		subscriber->mask = mask;
+	}
+	enter();
+	subscriber->next = participant->subscribers;
+	participant->subscribers = subscriber;
+	leave();
+	return subscriber;
+}
+
+DDS_ReturnCode_t DDS_DomainParticipant_delete_publisher(DDS_DomainParticipant* participant, DDS_Publisher* publisher) {
+	DDS_Publisher** lst;
+
+	enter();
+	if (publisher->writers != NULL) {
+		leave();
+		return DDS_RETCODE_PRECONDITION_NOT_MET;
+	}
+	for (lst = &participant->publishers; *lst != NULL; lst = &(*lst)->next) {
+		if (*lst == publisher) {
+			*lst = publisher->next;
+			break;
+		}
+	}
+	leave();
+	DDS_StringSeq_finalize(&publisher->partition);
+	free(publisher);
+	return DDS_RETCODE_OK;
+}
+
+DDS_ReturnCode_t DDS_DomainParticipant_delete_subscriber(DDS_DomainParticipant* participant,
+		DDS_Subscriber* subscriber) {
+	DDS_Subscriber** lst;
+
+	enter();
+	if (subscriber->readers != NULL) {
+		leave();
+		return DDS_RETCODE_PRECONDITION_NOT_MET;
+	}
+	for (lst = &participant->subscribers; *lst != NULL; lst = &(*lst)->next) {
+		if (*lst == subscriber) {
+			*lst = subscriber->next;
+			break;
+		}
+	}
+	leave();
+	DDS_StringSeq_finalize(&subscriber->partition);
+	free(subscriber);
+	return DDS_RETCODE_OK;
+}
+
+DDS_Topic* DDS_DomainParticipant_create_topic(DDS_DomainParticipant* participant, const char* topic_name,
+		const char* type_name, const struct DDS_TopicQos* qos, const void* listener, DDS_StatusMask mask) {
+	struct type_node* type;
+	DDS_Topic* topic = NULL;
+
+	enter();
+	for (type = participant->types; type != NULL; type = type->next) {
+		if (strcmp(type->name, type_name) == 0) {
+			break;
+		}
+	}
+	if (type != NULL && DDS_DomainParticipant_lookup_topicdescription(participant, topic_name) == NULL) {
+		topic = (DDS_Topic*) calloc(1, sizeof(DDS_Topic));
+		if (topic != NULL) {
+			topic->participant = participant;
+			topic->name = DDS_String_dup(topic_name);
+			topic->size = type->size;
+			topic->next = participant->topics;
+			participant->topics = topic;
+		}
+	}
+	leave();
+	return topic;
+}
+
+DDS_TopicDescription* DDS_DomainParticipant_lookup_topicdescription(DDS_DomainParticipant* participant,
+		const char* topic_name) {
+	DDS_Topic* topic;
+
+	enter();
+	for (topic = participant->topics; topic != NULL; topic = topic->next) {
+		if (strcmp(topic->name, topic_name) == 0) {
+			break;
+		}
+	}
+	leave();
+	return topic;
+}
+
+DDS_ReturnCode_t DDS_DomainParticipant_delete_contained_entities(DDS_DomainParticipant* participant) {
+	DDS_Topic* topic;
+
+	enter();
+	while (participant->publishers != NULL) {
+		DDS_Publisher_delete_contained_entities(participant->publishers);
+		DDS_DomainParticipant_delete_publisher(participant, participant->publishers);
+	}
+	while (participant->subscribers != NULL) {
+		DDS_Subscriber_delete_contained_entities(participant->subscribers);
+		DDS_DomainParticipant_delete_subscriber(participant, participant->subscribers);
+	}
+	while (participant->topics != NULL) {
+		topic = participant->topics;
+		participant->topics = topic->next;
+		free(topic->name);
+		free(topic);
+	}
+	leave();
+	return DDS_RETCODE_OK;
+}
+
+/* Topic */
+
+DDS_Topic* DDS_Topic_narrow(DDS_TopicDescription* description) {
+	return description;
+}
+
+DDS_TopicDescription* DDS_Topic_as_topicdescription(DDS_Topic* topic) {
+	return topic;
+}
+
+DDS_ContentFilteredTopic* DDS_DomainParticipant_create_contentfilteredtopic(DDS_DomainParticipant* participant,
+		const char* name, DDS_Topic* related_topic, const char* filter_expression,
+		const struct DDS_StringSeq* expression_parameters) {
+	//the fake does not evaluate filter expressions: the reader gets every sample of the related Topic
+	return related_topic;
+}
+
+DDS_TopicDescription* DDS_ContentFilteredTopic_as_topicdescription(DDS_ContentFilteredTopic* topic) {
+	return topic;
+}
+
+/* Publisher and DataWriter */
+
+DDS_ReturnCode_t DDS_Publisher_get_default_datawriter_qos(DDS_Publisher* publisher, struct DDS_DataWriterQos* qos) {
+	memset(qos, 0, sizeof(*qos));
+	qos->reliability.kind = DDS_RELIABLE_RELIABILITY_QOS;
+	qos->history.kind = DDS_KEEP_LAST_HISTORY_QOS;
+	qos->history.depth = 1;
+	qos->resource_limits.max_samples = DDS_LENGTH_UNLIMITED;
+	qos->resource_limits.max_instances = DDS_LENGTH_UNLIMITED;
+	qos->resource_limits.max_samples_per_instance = DDS_LENGTH_UNLIMITED;
+	return DDS_RETCODE_OK;
+}
+
+DDS_DataWriter* DDS_Publisher_create_datawriter(DDS_Publisher* publisher, DDS_Topic* topic,
+		const struct DDS_DataWriterQos* qos, const struct DDS_DataWriterListener* listener, DDS_StatusMask mask) {
+	DDS_DomainParticipant* p;
+	DDS_Subscriber* sub;
+	DDS_DataReader* r;
+	DDS_DataWriter* writer = (DDS_DataWriter*) calloc(1, sizeof(DDS_DataWriter));
+
+	if (writer == NULL) {
+		return NULL;
+	}
+	writer->publisher = publisher;
+	writer->topic = topic;
+	if (listener != NULL) {
+		writer->listener = *listener;
+		writer->mask = mask;
+	}
+	enter();
+	writer->next = publisher->writers;
+	publisher->writers = writer;
+	for (p = participants; p != NULL; p = p->next) {
+		for (sub = p->subscribers; sub != NULL; sub = sub->next) {
+			for (r = sub->readers; r != NULL; r = r->next) {
+				if (add_match(writer, r)) {
+					notify_match(writer, r);
+				}
+			}
+		}
+	}
+	leave();
+	return writer;
+}
+
+DDS_DataWriter* DDS_Publisher_lookup_datawriter(DDS_Publisher* publisher, const char* topic_name) {
+	DDS_DataWriter* writer;
+
+	if (publisher == NULL) {
+		return NULL;
+	}
+	enter();
+	for (writer = publisher->writers; writer != NULL; writer = writer->next) {
+		if (strcmp(writer->topic->name, topic_name) == 0) {
+			break;
+		}
+	}
+	leave();
+	return writer;
+}
+
+DDS_ReturnCode_t DDS_Publisher_delete_contained_entities(DDS_Publisher* publisher) {
+	DDS_DataWriter* writer;
+
+	enter();
+	while (publisher->writers != NULL) {
+		writer = publisher->writers;
+		publisher->writers = writer->next;
+		free(writer->matches);
+		free(writer);
+	}
+	leave();
+	return DDS_RETCODE_OK;
+}
+
+DDS_ReturnCode_t DDS_DataWriter_get_matched_subscription_data(DDS_DataWriter* writer,
+		struct DDS_SubscriptionBuiltinTopicData* data, const DDS_InstanceHandle_t* handle) {
+	DDS_Long i;
+	DDS_ReturnCode_t retcode = DDS_RETCODE_BAD_PARAMETER;
+
+	enter();
+	for (i = 0; i < writer->matchCount; i++) {
+		if (writer->matches[i] == handle->entity) {
+			copy_partition(&data->partition.name, &writer->matches[i]->subscriber->partition);
+			retcode = DDS_RETCODE_OK;
+			break;
+		}
+	}
+	leave();
+	return retcode;
+}
+
+DDS_ReturnCode_t DDS_DataWriter_get_matched_subscriptions(DDS_DataWriter* writer,
+		struct DDS_InstanceHandleSeq* subscription_handles) {
+	DDS_InstanceHandle_t* buffer;
+	DDS_Long i;
+	DDS_ReturnCode_t retcode = DDS_RETCODE_OK;
+
+	enter();
+	if (writer->matchCount > subscription_handles->maximum) {
+		buffer = realloc(subscription_handles->buffer, writer->matchCount * sizeof(DDS_InstanceHandle_t));
+		if (buffer == NULL) {
+			retcode = DDS_RETCODE_ERROR;
+		} else {
+			subscription_handles->buffer = buffer;
+			subscription_handles->maximum = writer->matchCount;
+		}
+	}
+	if (retcode == DDS_RETCODE_OK) {
+		for (i = 0; i < writer->matchCount; i++) {
+			subscription_handles->buffer[i].entity = writer->matches[i];
+		}
+		subscription_handles->length = writer->matchCount;
+	}
+	leave();
+	return retcode;
+}
+
+DDS_ReturnCode_t DDS_DataWriter_get_publication_matched_status(DDS_DataWriter* writer,
+		struct DDS_PublicationMatchedStatus* status) {
+	enter();
+	status->total_count = writer->totalMatched;
+	status->total_count_change = 0;
+	status->current_count = writer->matchCount;
+	status->current_count_change = 0;
+	status->last_subscription_handle = DDS_HANDLE_NIL;
+	leave();
+	return DDS_RETCODE_OK;
+}
+
+DDS_ReturnCode_t FakeDDS_DataWriter_write(DDS_DataWriter* writer, const void* sample) {
+	DDS_DataReader* reader;
+	size_t size;
+	DDS_Long i;
+	DDS_Long slot;
+
+	if (writer == NULL) {
+		return DDS_RETCODE_BAD_PARAMETER;
+	}
+	size = writer->topic->size;
+
+	enter();
+	for (i = 0; i < writer->matchCount; i++) {
+		reader = writer->matches[i];
+		if (reader->count == reader->capacity) {
+			if (!reader->keepLast) {
+				//KEEP_ALL: a reliable writer would block, the fake drops the sample
+				continue;
+			}
+			//KEEP_LAST: replace the oldest sample
+			reader->head = (reader->head + 1) % reader->capacity;
+			reader->count--;
+		}
+		slot = (reader->head + reader->count) % reader->capacity;
+		memcpy(reader->samples + (size_t) slot * size, sample, size);
+		reader->count++;
+	}
+	leave();
+	return DDS_RETCODE_OK;
+}
+
+DDS_ReturnCode_t DDS_DataWriter_flush(DDS_DataWriter* writer) {
+	//samples are delivered by the write already
+	return DDS_RETCODE_OK;
+}
+
+/* Subscriber and DataReader */
+
+DDS_ReturnCode_t DDS_Subscriber_get_default_datareader_qos(DDS_Subscriber* subscriber, struct DDS_DataReaderQos* qos) {
+	memset(qos, 0, sizeof(*qos));
+	qos->reliability.kind = DDS_BEST_EFFORT_RELIABILITY_QOS;
+	qos->history.kind = DDS_KEEP_LAST_HISTORY_QOS;
+	qos->history.depth = 1;
+	qos->resource_limits.max_samples = DDS_LENGTH_UNLIMITED;
+	qos->resource_limits.max_instances = DDS_LENGTH_UNLIMITED;
+	qos->resource_limits.max_samples_per_instance = DDS_LENGTH_UNLIMITED;
+	return DDS_RETCODE_OK;
+}
+
+DDS_DataReader* DDS_Subscriber_create_datareader(DDS_Subscriber* subscriber, DDS_TopicDescription* topic,
+		const struct DDS_DataReaderQos* qos, const struct DDS_DataReaderListener* listener, DDS_StatusMask mask) {
+	DDS_DomainParticipant* p;
+	DDS_Publisher* pub;
+	DDS_DataWriter* w;
+	DDS_DataReader* reader = (DDS_DataReader*) calloc(1, sizeof(DDS_DataReader));
+
+	if (reader == NULL) {
+		return NULL;
+	}
+	reader->subscriber = subscriber;
+	reader->topic = topic;
+	reader->keepLast = qos->history.kind == DDS_KEEP_LAST_HISTORY_QOS;
+	if (reader->keepLast) {
+		reader->capacity = qos->history.depth > 0 ? qos->history.depth : 1;
+	} else {
+		reader->capacity = qos->resource_limits.max_samples > 0 ? qos->resource_limits.max_samples
+				: FAKE_DDS_MAX_SAMPLES;
+	}
+	reader->samples = (char*) malloc((size_t) reader->capacity * topic->size);
+	if (reader->samples == NULL) {
+		free(reader);
+		return NULL;
+	}
+	if (listener != NULL) {
+		reader->listener = *listener;
+		reader->mask = mask;
+	}
+	enter();
+	reader->next = subscriber->readers;
+	subscriber->readers = reader;
+	for (p = participants; p != NULL; p = p->next) {
+		for (pub = p->publishers; pub != NULL; pub = pub->next) {
+			for (w = pub->writers; w != NULL; w = w->next) {
+				if (add_match(w, reader)) {
+					notify_match(w, reader);
+				}
+			}
+		}
+	}
+	leave();
+	return reader;
+}
+
+DDS_DataReader* DDS_Subscriber_lookup_datareader(DDS_Subscriber* subscriber, const char* topic_name) {
+	DDS_DataReader* reader;
+
+	if (subscriber == NULL) {
+		return NULL;
+	}
+	enter();
+	for (reader = subscriber->readers; reader != NULL; reader = reader->next) {
+		if (strcmp(reader->topic->name, topic_name) == 0) {
+			break;
+		}
+	}
+	leave();
+	return reader;
+}
+
+DDS_ReturnCode_t DDS_Subscriber_delete_contained_entities(DDS_Subscriber* subscriber) {
+	DDS_DataReader* reader;
+
+	enter();
+	while (subscriber->readers != NULL) {
+		reader = subscriber->readers;
+		subscriber->readers = reader->next;
+		remove_match(reader);
+		free(reader->samples);
+		free(reader);
+	}
+	leave();
+	return DDS_RETCODE_OK;
+}
+
+DDS_Entity* DDS_DataReader_as_entity(DDS_DataReader* reader) {
+	return reader;
+}
+
+DDS_ReturnCode_t DDS_DataReader_get_matched_publication_data(DDS_DataReader* reader,
+		struct DDS_PublicationBuiltinTopicData* data, const DDS_InstanceHandle_t* handle) {
+	const DDS_DataWriter* writer = (const DDS_DataWriter*) handle->entity;
+
+	if (writer == NULL) {
+		return DDS_RETCODE_BAD_PARAMETER;
+	}
+	enter();
+	copy_partition(&data->partition.name, &writer->publisher->partition);
+	leave();
+	return DDS_RETCODE_OK;
+}
+
+DDS_ReturnCode_t DDS_DataReader_get_datareader_cache_status(DDS_DataReader* reader,
+		struct DDS_DataReaderCacheStatus* status) {
+	if (reader == NULL) {
+		return DDS_RETCODE_BAD_PARAMETER;
+	}
+	enter();
+	status->sample_count = reader->count;
+	leave();
+	return DDS_RETCODE_OK;
+}
+
+DDS_ReturnCode_t FakeDDS_DataReader_take_next_sample(DDS_DataReader* reader, void* sample,
+		struct DDS_SampleInfo* info) {
+	size_t size;
+
+	if (reader == NULL) {
+		return DDS_RETCODE_BAD_PARAMETER;
+	}
+	size = reader->topic->size;
+
+	enter();
+	if (reader->count == 0) {
+		leave();
+		return DDS_RETCODE_NO_DATA;
+	}
+	memcpy(sample, reader->samples + (size_t) reader->head * size, size);
+	reader->head = (reader->head + 1) % reader->capacity;
+	reader->count--;
+	leave();
+	if (info != NULL) {
+		info->valid_data = DDS_BOOLEAN_TRUE;
+	}
+	return DDS_RETCODE_OK;
+}
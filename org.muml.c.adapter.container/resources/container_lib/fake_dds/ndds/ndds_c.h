@@ -0,0 +1,398 @@
+/**
+ * @file
+ * @brief In-process stand-in for the subset of the RTI Connext C API used by the container
+ * @details Lets DDS ports be built, benchmarked and tested without an RTI installation. Compile with
+ * -DMCC_FAKE_DDS and -I container_lib/fake_dds and link FakeDDS.o instead of the RTI libraries.
+ *
+ * All DomainParticipants of a process share one data space. A DataWriter copies every sample into the queue of each
+ * matching DataReader (same domain, topic name and a common partition). The queue of a DataReader holds
+ * history.depth samples for KEEP_LAST and resource_limits.max_samples (or FAKE_DDS_MAX_SAMPLES) for KEEP_ALL, where
+ * a full queue drops the new sample instead of blocking the writer. Listeners are called synchronously by the thread
+ * that creates the matching entity. Reliability, durability, deadline, latency budget, batching and the transport
+ * settings are accepted, but have no effect. A ContentFilteredTopic is its related Topic, the filter expression is
+ * not evaluated.
+ *
+ * The type support of a data type is defined by FAKE_DDS_TYPE(Type).
+ */
+#ifndef FAKE_NDDS_C_H_
+#define FAKE_NDDS_C_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef FAKE_DDS_MAX_SAMPLES
+#define FAKE_DDS_MAX_SAMPLES 1024 /**< queue length of a DataReader with unlimited KEEP_ALL history */
+#endif
+
+typedef int DDS_Long;
+typedef unsigned int DDS_UnsignedLong;
+typedef unsigned char DDS_Boolean;
+typedef int DDS_DomainId_t;
+typedef int DDS_ReturnCode_t;
+typedef unsigned int DDS_StatusMask;
+
+#define DDS_BOOLEAN_TRUE ((DDS_Boolean) 1)
+#define DDS_BOOLEAN_FALSE ((DDS_Boolean) 0)
+#define DDS_LENGTH_UNLIMITED (-1)
+
+#define DDS_RETCODE_OK 0
+#define DDS_RETCODE_ERROR 1
+#define DDS_RETCODE_BAD_PARAMETER 3
+#define DDS_RETCODE_PRECONDITION_NOT_MET 4
+#define DDS_RETCODE_NO_DATA 11
+
+#define DDS_STATUS_MASK_NONE ((DDS_StatusMask) 0)
+#define DDS_STATUS_MASK_ALL ((DDS_StatusMask) ~0u)
+#define DDS_LIVELINESS_LOST_STATUS ((DDS_StatusMask) 0x0800)
+#define DDS_LIVELINESS_CHANGED_STATUS ((DDS_StatusMask) 0x1000)
+#define DDS_PUBLICATION_MATCHED_STATUS ((DDS_StatusMask) 0x2000)
+#define DDS_SUBSCRIPTION_MATCHED_STATUS ((DDS_StatusMask) 0x4000)
+
+#define DDS_TRANSPORTBUILTIN_UDPv4 0x01
+#define DDS_TRANSPORTBUILTIN_SHMEM 0x02
+
+/* entities, their layout is private to FakeDDS.c */
+typedef struct DDS_DomainParticipantFactoryImpl DDS_DomainParticipantFactory;
+typedef struct DDS_DomainParticipantImpl DDS_DomainParticipant;
+typedef struct DDS_PublisherImpl DDS_Publisher;
+typedef struct DDS_SubscriberImpl DDS_Subscriber;
+typedef struct DDS_TopicImpl DDS_Topic;
+typedef struct DDS_TopicImpl DDS_TopicDescription;
+typedef struct DDS_TopicImpl DDS_ContentFilteredTopic;
+typedef struct DDS_DataWriterImpl DDS_DataWriter;
+typedef struct DDS_DataReaderImpl DDS_DataReader;
+typedef void DDS_Entity;
+
+#define DDS_TheParticipantFactory ((DDS_DomainParticipantFactory*) NULL)
+
+typedef struct DDS_InstanceHandle_t {
+	const void* entity; /**< the matched DataWriter or DataReader */
+} DDS_InstanceHandle_t;
+
+extern const DDS_InstanceHandle_t DDS_HANDLE_NIL;
+
+DDS_Boolean DDS_InstanceHandle_equals(const DDS_InstanceHandle_t* self, const DDS_InstanceHandle_t* other);
+DDS_InstanceHandle_t DDS_Entity_get_instance_handle(DDS_Entity* entity);
+
+/* strings and sequences */
+struct DDS_StringSeq {
+	char** buffer;
+	DDS_Long length;
+	DDS_Long maximum;
+};
+#define DDS_SEQUENCE_INITIALIZER { NULL, 0, 0 }
+
+char* DDS_String_dup(const char* str);
+DDS_Boolean DDS_StringSeq_ensure_length(struct DDS_StringSeq* seq, DDS_Long length, DDS_Long max);
+char** DDS_StringSeq_get_reference(struct DDS_StringSeq* seq, DDS_Long i);
+DDS_Long DDS_StringSeq_get_length(const struct DDS_StringSeq* seq);
+void DDS_StringSeq_finalize(struct DDS_StringSeq* seq);
+
+struct DDS_InstanceHandleSeq {
+	DDS_InstanceHandle_t* buffer;
+	DDS_Long length;
+	DDS_Long maximum;
+};
+
+DDS_InstanceHandle_t* DDS_InstanceHandleSeq_get_reference(struct DDS_InstanceHandleSeq* seq, DDS_Long i);
+DDS_Long DDS_InstanceHandleSeq_get_length(const struct DDS_InstanceHandleSeq* seq);
+void DDS_InstanceHandleSeq_finalize(struct DDS_InstanceHandleSeq* seq);
+
+/* QoS policies */
+typedef struct DDS_Duration_t {
+	DDS_Long sec;
+	DDS_UnsignedLong nanosec;
+} DDS_Duration_t;
+
+typedef enum {
+	DDS_BEST_EFFORT_RELIABILITY_QOS, DDS_RELIABLE_RELIABILITY_QOS
+} DDS_ReliabilityQosPolicyKind;
+
+typedef enum {
+	DDS_KEEP_LAST_HISTORY_QOS, DDS_KEEP_ALL_HISTORY_QOS
+} DDS_HistoryQosPolicyKind;
+
+typedef enum {
+	DDS_VOLATILE_DURABILITY_QOS, DDS_TRANSIENT_LOCAL_DURABILITY_QOS
+} DDS_DurabilityQosPolicyKind;
+
+typedef enum {
+	DDS_SYNCHRONOUS_PUBLISH_MODE_QOS, DDS_ASYNCHRONOUS_PUBLISH_MODE_QOS
+} DDS_PublishModeQosPolicyKind;
+
+struct DDS_PartitionQosPolicy {
+	struct DDS_StringSeq name;
+};
+struct DDS_ReliabilityQosPolicy {
+	DDS_ReliabilityQosPolicyKind kind;
+};
+struct DDS_HistoryQosPolicy {
+	DDS_HistoryQosPolicyKind kind;
+	DDS_Long depth;
+};
+struct DDS_DurabilityQosPolicy {
+	DDS_DurabilityQosPolicyKind kind;
+};
+struct DDS_ResourceLimitsQosPolicy {
+	DDS_Long max_samples;
+	DDS_Long max_instances;
+	DDS_Long max_samples_per_instance;
+};
+struct DDS_DeadlineQosPolicy {
+	DDS_Duration_t period;
+};
+struct DDS_LatencyBudgetQosPolicy {
+	DDS_Duration_t duration;
+};
+struct DDS_BatchQosPolicy {
+	DDS_Boolean enable;
+	DDS_Long max_data_bytes;
+	DDS_Long max_samples;
+	DDS_Duration_t max_flush_delay;
+};
+struct DDS_PublishModeQosPolicy {
+	DDS_PublishModeQosPolicyKind kind;
+};
+struct DDS_TransportBuiltinQosPolicy {
+	DDS_Long mask;
+};
+struct DDS_ThreadSettings_t {
+	DDS_Long priority;
+};
+struct DDS_ReceiverPoolQosPolicy {
+	struct DDS_ThreadSettings_t thread;
+};
+
+struct DDS_DomainParticipantQos {
+	struct DDS_TransportBuiltinQosPolicy transport_builtin;
+	struct DDS_ReceiverPoolQosPolicy receiver_pool;
+};
+struct DDS_PublisherQos {
+	struct DDS_PartitionQosPolicy partition;
+};
+struct DDS_SubscriberQos {
+	struct DDS_PartitionQosPolicy partition;
+};
+struct DDS_TopicQos {
+	DDS_Long unused;
+};
+struct DDS_DataWriterQos {
+	struct DDS_ReliabilityQosPolicy reliability;
+	struct DDS_HistoryQosPolicy history;
+	struct DDS_DurabilityQosPolicy durability;
+	struct DDS_ResourceLimitsQosPolicy resource_limits;
+	struct DDS_DeadlineQosPolicy deadline;
+	struct DDS_LatencyBudgetQosPolicy latency_budget;
+	struct DDS_BatchQosPolicy batch;
+	struct DDS_PublishModeQosPolicy publish_mode;
+};
+struct DDS_DataReaderQos {
+	struct DDS_ReliabilityQosPolicy reliability;
+	struct DDS_HistoryQosPolicy history;
+	struct DDS_DurabilityQosPolicy durability;
+	struct DDS_ResourceLimitsQosPolicy resource_limits;
+	struct DDS_DeadlineQosPolicy deadline;
+	struct DDS_LatencyBudgetQosPolicy latency_budget;
+};
+
+#define DDS_DomainParticipantQos_INITIALIZER { { 0 }, { { 0 } } }
+#define DDS_PublisherQos_INITIALIZER { { { NULL, 0, 0 } } }
+#define DDS_SubscriberQos_INITIALIZER { { { NULL, 0, 0 } } }
+#define DDS_DataWriterQos_INITIALIZER { { DDS_RELIABLE_RELIABILITY_QOS }, { DDS_KEEP_LAST_HISTORY_QOS, 1 } }
+#define DDS_DataReaderQos_INITIALIZER { { DDS_BEST_EFFORT_RELIABILITY_QOS }, { DDS_KEEP_LAST_HISTORY_QOS, 1 } }
+
+extern const struct DDS_TopicQos DDS_TOPIC_QOS_DEFAULT;
+
+DDS_ReturnCode_t DDS_DomainParticipantQos_finalize(struct DDS_DomainParticipantQos* qos);
+DDS_ReturnCode_t DDS_PublisherQos_finalize(struct DDS_PublisherQos* qos);
+DDS_ReturnCode_t DDS_SubscriberQos_finalize(struct DDS_SubscriberQos* qos);
+DDS_ReturnCode_t DDS_DataWriterQos_finalize(struct DDS_DataWriterQos* qos);
+DDS_ReturnCode_t DDS_DataReaderQos_finalize(struct DDS_DataReaderQos* qos);
+
+/* status */
+struct DDS_PublicationMatchedStatus {
+	DDS_Long total_count;
+	DDS_Long total_count_change;
+	DDS_Long current_count;
+	DDS_Long current_count_change;
+	DDS_InstanceHandle_t last_subscription_handle;
+};
+#define DDS_PublicationMatchedStatus_INITIALIZER { 0, 0, 0, 0, { NULL } }
+struct DDS_SubscriptionMatchedStatus {
+	DDS_Long total_count;
+	DDS_Long total_count_change;
+	DDS_Long current_count;
+	DDS_Long current_count_change;
+	DDS_InstanceHandle_t last_publication_handle;
+};
+struct DDS_LivelinessLostStatus {
+	DDS_Long total_count;
+	DDS_Long total_count_change;
+};
+struct DDS_LivelinessChangedStatus {
+	DDS_Long alive_count;
+	DDS_Long not_alive_count;
+	DDS_Long alive_count_change;
+	DDS_Long not_alive_count_change;
+	DDS_InstanceHandle_t last_publication_handle;
+};
+struct DDS_SampleInfo {
+	DDS_Boolean valid_data;
+};
+struct DDS_DataReaderCacheStatus {
+	DDS_Long sample_count;
+};
+#define DDS_DataReaderCacheStatus_INITIALIZER { 0 }
+DDS_ReturnCode_t DDS_DataReaderCacheStatus_finalize(struct DDS_DataReaderCacheStatus* status);
+
+struct DDS_PublicationBuiltinTopicData {
+	struct DDS_PartitionQosPolicy partition;
+};
+struct DDS_SubscriptionBuiltinTopicData {
+	struct DDS_PartitionQosPolicy partition;
+};
+#define DDS_PublicationBuiltinTopicData_INITIALIZER { { { NULL, 0, 0 } } }
+#define DDS_SubscriptionBuiltinTopicData_INITIALIZER { { { NULL, 0, 0 } } }
+void DDS_PublicationBuiltinTopicData_finalize(struct DDS_PublicationBuiltinTopicData* data);
+void DDS_SubscriptionBuiltinTopicData_finalize(struct DDS_SubscriptionBuiltinTopicData* data);
+
+/* listeners */
+struct DDS_Listener {
+	void* listener_data;
+};
+struct DDS_DataWriterListener {
+	struct DDS_Listener as_listener;
+	void (*on_liveliness_lost)(void* listener_data, DDS_DataWriter* writer,
+			const struct DDS_LivelinessLostStatus* status);
+	void (*on_publication_matched)(void* listener_data, DDS_DataWriter* writer,
+			const struct DDS_PublicationMatchedStatus* status);
+};
+struct DDS_DataReaderListener {
+	struct DDS_Listener as_listener;
+	void (*on_liveliness_changed)(void* listener_data, DDS_DataReader* reader,
+			const struct DDS_LivelinessChangedStatus* status);
+	void (*on_subscription_matched)(void* listener_data, DDS_DataReader* reader,
+			const struct DDS_SubscriptionMatchedStatus* status);
+};
+struct DDS_PublisherListener {
+	struct DDS_DataWriterListener as_datawriterlistener;
+};
+struct DDS_SubscriberListener {
+	struct DDS_DataReaderListener as_datareaderlistener;
+};
+#define DDS_DataWriterListener_INITIALIZER { { NULL }, NULL, NULL }
+#define DDS_DataReaderListener_INITIALIZER { { NULL }, NULL, NULL }
+#define DDS_PublisherListener_INITIALIZER { { { NULL }, NULL, NULL } }
+#define DDS_SubscriberListener_INITIALIZER { { { NULL }, NULL, NULL } }
+
+/* DomainParticipantFactory */
+DDS_ReturnCode_t DDS_DomainParticipantFactory_get_default_participant_qos(DDS_DomainParticipantFactory* factory,
+		struct DDS_DomainParticipantQos* qos);
+DDS_DomainParticipant* DDS_DomainParticipantFactory_create_participant(DDS_DomainParticipantFactory* factory,
+		DDS_DomainId_t domainId, const struct DDS_DomainParticipantQos* qos, const void* listener, DDS_StatusMask mask);
+DDS_ReturnCode_t DDS_DomainParticipantFactory_delete_participant(DDS_DomainParticipantFactory* factory,
+		DDS_DomainParticipant* participant);
+DDS_ReturnCode_t DDS_DomainParticipantFactory_finalize_instance(void);
+
+/* DomainParticipant */
+DDS_ReturnCode_t DDS_DomainParticipant_get_default_publisher_qos(DDS_DomainParticipant* participant,
+		struct DDS_PublisherQos* qos);
+DDS_ReturnCode_t DDS_DomainParticipant_get_default_subscriber_qos(DDS_DomainParticipant* participant,
+		struct DDS_SubscriberQos* qos);
+DDS_Publisher* DDS_DomainParticipant_create_publisher(DDS_DomainParticipant* participant,
+		const struct DDS_PublisherQos* qos, const struct DDS_PublisherListener* listener, DDS_StatusMask mask);
+DDS_Subscriber* DDS_DomainParticipant_create_subscriber(DDS_DomainParticipant* participant,
+		const struct DDS_SubscriberQos* qos, const struct DDS_SubscriberListener* listener, DDS_StatusMask mask);
+DDS_ReturnCode_t DDS_DomainParticipant_delete_publisher(DDS_DomainParticipant* participant, DDS_Publisher* publisher);
+DDS_ReturnCode_t DDS_DomainParticipant_delete_subscriber(DDS_DomainParticipant* participant,
+		DDS_Subscriber* subscriber);
+DDS_Topic* DDS_DomainParticipant_create_topic(DDS_DomainParticipant* participant, const char* topic_name,
+		const char* type_name, const struct DDS_TopicQos* qos, const void* listener, DDS_StatusMask mask);
+DDS_TopicDescription* DDS_DomainParticipant_lookup_topicdescription(DDS_DomainParticipant* participant,
+		const char* topic_name);
+DDS_ReturnCode_t DDS_DomainParticipant_delete_contained_entities(DDS_DomainParticipant* participant);
+
+/* Topic */
+DDS_Topic* DDS_Topic_narrow(DDS_TopicDescription* description);
+DDS_TopicDescription* DDS_Topic_as_topicdescription(DDS_Topic* topic);
+DDS_ContentFilteredTopic* DDS_DomainParticipant_create_contentfilteredtopic(DDS_DomainParticipant* participant,
+		const char* name, DDS_Topic* related_topic, const char* filter_expression,
+		const struct DDS_StringSeq* expression_parameters);
+DDS_TopicDescription* DDS_ContentFilteredTopic_as_topicdescription(DDS_ContentFilteredTopic* topic);
+
+/* Publisher and DataWriter */
+DDS_ReturnCode_t DDS_Publisher_get_default_datawriter_qos(DDS_Publisher* publisher, struct DDS_DataWriterQos* qos);
+DDS_DataWriter* DDS_Publisher_create_datawriter(DDS_Publisher* publisher, DDS_Topic* topic,
+		const struct DDS_DataWriterQos* qos, const struct DDS_DataWriterListener* listener, DDS_StatusMask mask);
+DDS_DataWriter* DDS_Publisher_lookup_datawriter(DDS_Publisher* publisher, const char* topic_name);
+DDS_ReturnCode_t DDS_Publisher_delete_contained_entities(DDS_Publisher* publisher);
+DDS_ReturnCode_t DDS_DataWriter_get_matched_subscription_data(DDS_DataWriter* writer,
+		struct DDS_SubscriptionBuiltinTopicData* data, const DDS_InstanceHandle_t* handle);
+DDS_ReturnCode_t DDS_DataWriter_get_matched_subscriptions(DDS_DataWriter* writer,
+		struct DDS_InstanceHandleSeq* subscription_handles);
+DDS_ReturnCode_t DDS_DataWriter_get_publication_matched_status(DDS_DataWriter* writer,
+		struct DDS_PublicationMatchedStatus* status);
+DDS_ReturnCode_t DDS_DataWriter_flush(DDS_DataWriter* writer);
+
+/* Subscriber and DataReader */
+DDS_ReturnCode_t DDS_Subscriber_get_default_datareader_qos(DDS_Subscriber* subscriber, struct DDS_DataReaderQos* qos);
+DDS_DataReader* DDS_Subscriber_create_datareader(DDS_Subscriber* subscriber, DDS_TopicDescription* topic,
+		const struct DDS_DataReaderQos* qos, const struct DDS_DataReaderListener* listener, DDS_StatusMask mask);
+DDS_DataReader* DDS_Subscriber_lookup_datareader(DDS_Subscriber* subscriber, const char* topic_name);
+DDS_ReturnCode_t DDS_Subscriber_delete_contained_entities(DDS_Subscriber* subscriber);
+DDS_Entity* DDS_DataReader_as_entity(DDS_DataReader* reader);
+DDS_ReturnCode_t DDS_DataReader_get_matched_publication_data(DDS_DataReader* reader,
+		struct DDS_PublicationBuiltinTopicData* data, const DDS_InstanceHandle_t* handle);
+DDS_ReturnCode_t DDS_DataReader_get_datareader_cache_status(DDS_DataReader* reader,
+		struct DDS_DataReaderCacheStatus* status);
+
+/* untyped access used by FAKE_DDS_TYPE */
+DDS_ReturnCode_t FakeDDS_register_type(DDS_DomainParticipant* participant, const char* type_name, size_t size);
+DDS_ReturnCode_t FakeDDS_DataWriter_write(DDS_DataWriter* writer, const void* sample);
+DDS_ReturnCode_t FakeDDS_DataReader_take_next_sample(DDS_DataReader* reader, void* sample,
+		struct DDS_SampleInfo* info);
+
+/**
+ * @brief Defines the type support, DataWriter and DataReader of a data type like rtiddsgen does
+ */
+#define FAKE_DDS_TYPE(Type) \
+typedef DDS_DataWriter Type##DataWriter; \
+typedef DDS_DataReader Type##DataReader; \
+static inline const char* Type##TypeSupport_get_type_name(void) { \
+	return #Type; \
+} \
+static inline DDS_ReturnCode_t Type##TypeSupport_register_type(DDS_DomainParticipant* participant, \
+		const char* type_name) { \
+	return FakeDDS_register_type(participant, type_name, sizeof(Type)); \
+} \
+static inline Type* Type##TypeSupport_create_data_ex(DDS_Boolean allocate_pointers) { \
+	return (Type*) calloc(1, sizeof(Type)); \
+} \
+static inline DDS_ReturnCode_t Type##TypeSupport_delete_data_ex(Type* sample, DDS_Boolean deallocate_pointers) { \
+	free(sample); \
+	return DDS_RETCODE_OK; \
+} \
+static inline Type##DataWriter* Type##DataWriter_narrow(DDS_DataWriter* writer) { \
+	return writer; \
+} \
+static inline DDS_ReturnCode_t Type##DataWriter_write(Type##DataWriter* writer, const Type* sample, \
+		const DDS_InstanceHandle_t* handle) { \
+	return FakeDDS_DataWriter_write(writer, sample); \
+} \
+static inline Type##DataReader* Type##DataReader_narrow(DDS_DataReader* reader) { \
+	return reader; \
+} \
+static inline DDS_ReturnCode_t Type##DataReader_take_next_sample(Type##DataReader* reader, Type* sample, \
+		struct DDS_SampleInfo* info) { \
+	return FakeDDS_DataReader_take_next_sample(reader, sample, info); \
+}
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* FAKE_NDDS_C_H_ */